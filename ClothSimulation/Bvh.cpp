@@ -0,0 +1,220 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+TriangleBvh::TriangleBvh(const unsigned int *ibuff, unsigned int ibuffLen, const float *positions, unsigned int stride)
+    : indices(ibuff), order(ibuffLen / 3), positions(positions), stride(stride)
+{
+    assert(ibuffLen % 3 == 0 && ibuffLen > 0);
+    const unsigned int n_faces = ibuffLen / 3;
+
+    // split on triangle centroids
+    std::vector<float> centroids(3 * n_faces);
+    for (unsigned int f = 0; f < n_faces; f++)
+    {
+        order[f] = f;
+        for (int j = 0; j < 3; j++)
+            centroids[3 * f + j] = (vertex(indices[3 * f])[j] + vertex(indices[3 * f + 1])[j] +
+                                    vertex(indices[3 * f + 2])[j]) / 3.0f;
+    }
+    nodes.reserve(2 * (n_faces / leaf_size + 1));
+    build(0, n_faces, centroids);
+    refit(positions, stride);
+}
+
+const float *TriangleBvh::vertex(unsigned int i) const { return positions + stride * i; }
+
+unsigned int TriangleBvh::build(unsigned int first, unsigned int count, const std::vector<float> &centroids)
+{
+    unsigned int index = (unsigned int)nodes.size();
+    nodes.push_back(Node());
+    if (count <= leaf_size)
+    {
+        nodes[index].first = first;
+        nodes[index].count = count;
+        return index;
+    }
+
+    // median split along the widest centroid extent
+    float lo[3], hi[3];
+    for (int j = 0; j < 3; j++)
+    {
+        lo[j] = std::numeric_limits<float>::max();
+        hi[j] = -std::numeric_limits<float>::max();
+    }
+    for (unsigned int k = first; k < first + count; k++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            lo[j] = std::min(lo[j], centroids[3 * order[k] + j]);
+            hi[j] = std::max(hi[j], centroids[3 * order[k] + j]);
+        }
+    }
+    int axis = 0;
+    for (int j = 1; j < 3; j++)
+    {
+        if (hi[j] - lo[j] > hi[axis] - lo[axis])
+            axis = j;
+    }
+    unsigned int half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                     [&](unsigned int a, unsigned int b)
+                     { return centroids[3 * a + axis] < centroids[3 * b + axis]; });
+
+    build(first, half, centroids);
+    unsigned int right = build(first + half, count - half, centroids);
+    nodes[index].first = right;
+    nodes[index].count = 0;
+    return index;
+}
+
+void TriangleBvh::refit(const float *positions, unsigned int stride)
+{
+    this->positions = positions;
+    this->stride = stride;
+
+    // children follow their parents
+    for (size_t k = nodes.size(); k-- > 0;)
+    {
+        Node &node = nodes[k];
+        for (int j = 0; j < 3; j++)
+        {
+            node.lo[j] = std::numeric_limits<float>::max();
+            node.hi[j] = -std::numeric_limits<float>::max();
+        }
+        if (node.count > 0)
+        {
+            for (unsigned int t = node.first; t < node.first + node.count; t++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    const float *p = vertex(indices[3 * order[t] + c]);
+                    for (int j = 0; j < 3; j++)
+                    {
+                        node.lo[j] = std::min(node.lo[j], p[j]);
+                        node.hi[j] = std::max(node.hi[j], p[j]);
+                    }
+                }
+            }
+        }
+        else
+        {
+            const Node &left = nodes[k + 1], &right = nodes[node.first];
+            for (int j = 0; j < 3; j++)
+            {
+                node.lo[j] = std::min(left.lo[j], right.lo[j]);
+                node.hi[j] = std::max(left.hi[j], right.hi[j]);
+            }
+        }
+    }
+}
+
+bool TriangleBvh::intersect(const float *origin, const float *dir, Hit &hit) const
+{
+    float inv_dir[3];
+    for (int j = 0; j < 3; j++)
+        inv_dir[j] = 1.0f / dir[j]; // infinite for axis-parallel rays, handled by the slab test
+
+    // nearest box entry, max if missed
+    auto enter = [&](const Node &node)
+    {
+        float t0 = 0.0f, t1 = std::numeric_limits<float>::max();
+        for (int j = 0; j < 3; j++)
+        {
+            float a = (node.lo[j] - origin[j]) * inv_dir[j];
+            float b = (node.hi[j] - origin[j]) * inv_dir[j];
+            if (a > b)
+                std::swap(a, b);
+            t0 = a > t0 ? a : t0; // nan safe for flat boxes along the ray
+            t1 = b < t1 ? b : t1;
+        }
+        return t0 <= t1 ? t0 : std::numeric_limits<float>::max();
+    };
+
+    bool found = false;
+    hit.t = std::numeric_limits<float>::max();
+    unsigned int stack[64];
+    unsigned int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node &node = nodes[stack[--top]];
+        if (enter(node) >= hit.t)
+            continue;
+
+        if (node.count == 0)
+        {
+            // visit the nearer child first
+            unsigned int left = (unsigned int)(&node - nodes.data()) + 1, right = node.first;
+            float t_left = enter(nodes[left]), t_right = enter(nodes[right]);
+            if (t_left > t_right)
+            {
+                std::swap(left, right);
+                std::swap(t_left, t_right);
+            }
+            if (t_right < hit.t)
+                stack[top++] = right;
+            if (t_left < hit.t)
+                stack[top++] = left;
+            assert(top <= 64);
+            continue;
+        }
+
+        // Moller-Trumbore
+        for (unsigned int k = node.first; k < node.first + node.count; k++)
+        {
+            unsigned int f = order[k];
+            const float *p0 = vertex(indices[3 * f]), *p1 = vertex(indices[3 * f + 1]), *p2 = vertex(indices[3 * f + 2]);
+            float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float p[3] = {dir[1] * e2[2] - dir[2] * e2[1], dir[2] * e2[0] - dir[0] * e2[2], dir[0] * e2[1] - dir[1] * e2[0]};
+            float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+            if (std::fabs(det) < 1e-12f)
+                continue;
+            float inv_det = 1.0f / det;
+            float s[3] = {origin[0] - p0[0], origin[1] - p0[1], origin[2] - p0[2]};
+            float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv_det;
+            if (u < 0.0f || u > 1.0f)
+                continue;
+            float q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+            float v = (dir[0] * q[0] + dir[1] * q[1] + dir[2] * q[2]) * inv_det;
+            if (v < 0.0f || u + v > 1.0f)
+                continue;
+            float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv_det;
+            if (t >= 0.0f && t < hit.t)
+            {
+                hit.face = f;
+                hit.t = t;
+                hit.u = u;
+                hit.v = v;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+unsigned int TriangleBvh::nearestVertex(const Hit &hit) const
+{
+    const unsigned int *face = indices + 3 * hit.face;
+    const float *p0 = vertex(face[0]), *p1 = vertex(face[1]), *p2 = vertex(face[2]);
+    float x[3];
+    for (int j = 0; j < 3; j++)
+        x[j] = (1.0f - hit.u - hit.v) * p0[j] + hit.u * p1[j] + hit.v * p2[j];
+
+    unsigned int nearest = face[0];
+    float nearest_d2 = std::numeric_limits<float>::max();
+    for (int c = 0; c < 3; c++)
+    {
+        const float *p = vertex(face[c]);
+        float d2 = (p[0] - x[0]) * (p[0] - x[0]) + (p[1] - x[1]) * (p[1] - x[1]) + (p[2] - x[2]) * (p[2] - x[2]);
+        if (d2 < nearest_d2)
+        {
+            nearest = face[c];
+            nearest_d2 = d2;
+        }
+    }
+    return nearest;
+}
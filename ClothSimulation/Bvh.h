@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+
+// Triangle bounding volume hierarchy for ray casts against a deforming mesh
+//
+// The tree is built once from the rest positions by median splits and only
+// refit afterwards: the triangle order stays fixed and the bounds are
+// recomputed bottom up from the current positions. Nodes are stored depth
+// first, so a node's left child directly follows it and a reverse sweep
+// visits children before parents. Positions are read with a stride in
+// floats, 3 for flat vertex buffers and 4 for PackedVertex streams.
+class TriangleBvh
+{
+public:
+    struct Hit
+    {
+        unsigned int face; // hit triangle
+        float t;           // ray parameter, origin + t * dir
+        float u, v;        // barycentric coordinates of the second and third vertex
+    };
+
+private:
+    struct Node
+    {
+        float lo[3], hi[3];
+        unsigned int first;  // leaf: first triangle in order, inner: right child
+        unsigned int count;  // leaf: number of triangles, 0 for inner nodes
+    };
+
+    static const unsigned int leaf_size = 4;
+
+    const unsigned int *indices;      // triangle indices, 3 per face
+    std::vector<unsigned int> order;  // faces in leaf order
+    std::vector<Node> nodes;
+    const float *positions;           // positions of the last refit
+    unsigned int stride;
+
+    unsigned int build(unsigned int first, unsigned int count, const std::vector<float> &centroids);
+    const float *vertex(unsigned int i) const;
+
+public:
+    // the index buffer is not copied and must outlive the tree
+    TriangleBvh(const unsigned int *ibuff, unsigned int ibuffLen, const float *positions, unsigned int stride = 3);
+
+    void refit(const float *positions, unsigned int stride = 3); // positions must stay valid until the next refit
+
+    bool intersect(const float *origin, const float *dir, Hit &hit) const; // nearest hit
+    unsigned int nearestVertex(const Hit &hit) const;                     // vertex of the hit face closest to the hit
+};
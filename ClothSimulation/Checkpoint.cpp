@@ -0,0 +1,206 @@
+#include "Checkpoint.h"
+#include "Sleep.h"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char g_magic[8] = "FMSCKPT";
+static const uint32_t g_byte_order = 0x01020304;
+
+static uint64_t alignUp(uint64_t offset)
+{
+    return (offset + Checkpoint::alignment - 1) / Checkpoint::alignment * Checkpoint::alignment;
+}
+
+// section offsets and file size for a system
+static void computeLayout(uint64_t n_points, uint64_t n_fixers, uint64_t n_pins, uint64_t offsets[3],
+                          uint64_t &file_size)
+{
+    const uint64_t state_size = sizeof(float) * 3 * n_points;
+    offsets[0] = alignUp(sizeof(CheckpointHeader));
+    offsets[1] = alignUp(offsets[0] + state_size);
+    offsets[2] = alignUp(offsets[1] + state_size);
+    file_size = offsets[2] + sizeof(uint32_t) * (n_fixers + n_pins) + sizeof(float) * 3 * n_pins;
+}
+
+// write all bytes, retrying on partial writes
+static void writeAll(int fd, const void *data, uint64_t size)
+{
+    const char *p = (const char *)data;
+    while (size > 0)
+    {
+        ssize_t written = ::write(fd, p, size);
+        if (written <= 0)
+            throw std::runtime_error("Failed to write checkpoint.");
+        p += written;
+        size -= written;
+    }
+}
+
+// pad the file with zeros up to offset
+static void padTo(int fd, uint64_t &pos, uint64_t offset)
+{
+    static const char zeros[Checkpoint::alignment] = {};
+    writeAll(fd, zeros, offset - pos);
+    pos = offset;
+}
+
+void Checkpoint::save(const char *path, MassSpringSolver &solver, const FixerList &fixers,
+                      const CgRegionFixNode *grabber)
+{
+    mass_spring_system *system = solver.getSystem();
+    if (grabber && grabber->regionSize() > 0)
+        throw std::runtime_error("Cannot save a checkpoint while a region is grabbed.");
+
+    // gather pins, these are the only data not already in flat buffers
+    std::vector<uint32_t> counts(fixers.size());
+    unsigned int n_pins = 0;
+    for (size_t f = 0; f < fixers.size(); f++)
+    {
+        counts[f] = fixers[f]->pinCount();
+        n_pins += counts[f];
+    }
+    std::vector<unsigned int> pin_indices(n_pins);
+    std::vector<float> pin_positions(3 * n_pins);
+    unsigned int k = 0;
+    for (size_t f = 0; f < fixers.size(); f++)
+    {
+        fixers[f]->getPins(&pin_indices[k], &pin_positions[3 * k]);
+        k += counts[f];
+    }
+
+    // layout
+    CheckpointHeader header = {};
+    std::memcpy(header.magic, g_magic, sizeof(g_magic));
+    header.version = version;
+    header.byte_order = g_byte_order;
+    header.n_points = system->n_points;
+    header.n_springs = system->n_springs;
+    header.n_fixers = (uint32_t)fixers.size();
+    header.n_pins = n_pins;
+    header.time_step = system->time_step;
+    header.damping_factor = system->damping_factor;
+
+    const uint64_t state_size = sizeof(float) * 3 * (uint64_t)system->n_points;
+    computeLayout(system->n_points, fixers.size(), n_pins, header.offsets, header.file_size);
+
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error(std::string("Failed to open checkpoint ") + path);
+
+    // sections are written straight from the solver buffers
+    try
+    {
+        uint64_t pos = 0;
+        writeAll(fd, &header, sizeof(header));
+        pos += sizeof(header);
+        padTo(fd, pos, header.offsets[0]);
+        writeAll(fd, solver.currentState(), state_size);
+        pos += state_size;
+        padTo(fd, pos, header.offsets[1]);
+        writeAll(fd, solver.previousState(), state_size);
+        pos += state_size;
+        padTo(fd, pos, header.offsets[2]);
+        writeAll(fd, counts.data(), sizeof(uint32_t) * counts.size());
+        writeAll(fd, pin_indices.data(), sizeof(uint32_t) * n_pins);
+        writeAll(fd, pin_positions.data(), sizeof(float) * 3 * n_pins);
+    }
+    catch (const std::runtime_error &)
+    {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+}
+
+void Checkpoint::restore(const char *path, MassSpringSolver &solver, const FixerList &fixers,
+                         CgRegionFixNode *grabber)
+{
+    mass_spring_system *system = solver.getSystem();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error(std::string("Failed to open checkpoint ") + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(CheckpointHeader))
+    {
+        ::close(fd);
+        throw std::runtime_error("Invalid checkpoint file.");
+    }
+
+    // map the whole file, the mapping outlives the descriptor
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        throw std::runtime_error("Failed to map checkpoint.");
+    madvise(mapping, st.st_size, MADV_WILLNEED);
+    const char *base = (const char *)mapping;
+    const CheckpointHeader *header = (const CheckpointHeader *)base;
+
+    // validate
+    const char *error = nullptr;
+    uint64_t offsets[3], file_size;
+    computeLayout(header->n_points, header->n_fixers, header->n_pins, offsets, file_size);
+    if (std::memcmp(header->magic, g_magic, sizeof(g_magic)) != 0)
+        error = "Not a checkpoint file.";
+    else if (header->byte_order != g_byte_order)
+        error = "Checkpoint byte order does not match.";
+    else if (header->version != version)
+        error = "Unsupported checkpoint version.";
+    else if (header->file_size != (uint64_t)st.st_size || file_size != header->file_size ||
+             std::memcmp(offsets, header->offsets, sizeof(offsets)) != 0)
+        error = "Truncated or corrupt checkpoint file.";
+    else if (header->n_points != system->n_points || header->n_springs != system->n_springs)
+        error = "Checkpoint does not match the mass spring system.";
+    else if (header->time_step != system->time_step)
+        error = "Checkpoint time step does not match the factored system.";
+    else if (header->n_fixers != fixers.size())
+        error = "Checkpoint does not match the constraint graph.";
+
+    // pin counts and indices must be consistent with the header
+    const uint32_t *counts = (const uint32_t *)(base + header->offsets[2]);
+    const uint32_t *pin_indices = counts + header->n_fixers;
+    if (!error)
+    {
+        uint64_t n_pins = 0;
+        for (size_t f = 0; f < fixers.size(); f++)
+            n_pins += counts[f];
+        if (n_pins != header->n_pins)
+            error = "Corrupt checkpoint pin section.";
+        for (uint64_t k = 0; !error && k < n_pins; k++)
+        {
+            if (pin_indices[k] >= system->n_points)
+                error = "Corrupt checkpoint pin section.";
+        }
+    }
+    if (error)
+    {
+        munmap(mapping, st.st_size);
+        throw std::runtime_error(error);
+    }
+
+    // copy sections into the solver buffers
+    const uint64_t state_size = sizeof(float) * 3 * (uint64_t)system->n_points;
+    std::memcpy(solver.currentState(), base + header->offsets[0], state_size);
+    std::memcpy(solver.previousState(), base + header->offsets[1], state_size);
+    system->damping_factor = header->damping_factor;
+    if (system->sleep)
+        system->sleep->wakeAll(); // sleep state is not saved, the restored state may move
+
+    // pins
+    const float *pin_positions = (const float *)(pin_indices + header->n_pins);
+    for (size_t f = 0; f < fixers.size(); f++)
+    {
+        fixers[f]->setPins(counts[f], pin_indices, pin_positions);
+        pin_indices += counts[f];
+        pin_positions += 3 * counts[f];
+    }
+    if (grabber)
+        grabber->release();
+
+    munmap(mapping, st.st_size);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "MassSpringSolver.h"
+
+// Checkpoint file header
+//
+// A checkpoint is the header followed by three sections, each starting on a
+// 64-byte boundary so a mapped file can be read with aligned vector loads:
+//   current state      3 * n_points floats
+//   previous state     3 * n_points floats
+//   pins               n_fixers pin counts, then all pin indices, then 3 floats per pin
+// Version 1 files also stored the spring directions, which the solver no
+// longer keeps between iterations. Regions grabbed with a CgRegionFixNode are
+// transient and not part of a checkpoint: saving during a grab is rejected.
+struct CheckpointHeader
+{
+    char magic[8];           // "FMSCKPT"
+    uint32_t version;        // format version
+    uint32_t byte_order;     // 0x01020304 in the writer's byte order
+    uint32_t n_points;       // number of points
+    uint32_t n_springs;      // number of springs
+    uint32_t n_fixers;       // number of point fix nodes
+    uint32_t n_pins;         // total number of pinned points
+    float time_step;         // time step
+    float damping_factor;    // damping factor
+    uint64_t offsets[3];     // section offsets | current, previous, pins
+    uint64_t file_size;      // total file size
+};
+
+// Checkpoint writer / reader
+class Checkpoint
+{
+public:
+    typedef std::vector<CgPointFixNode *> FixerList;
+
+    static const uint32_t version = 2;
+    static const uint64_t alignment = 64;
+
+    // write solver state and the pin sets of fixers to path; a grabbed region is
+    // not saved, so saving while grabber holds one throws std::runtime_error
+    static void save(const char *path, MassSpringSolver &solver, const FixerList &fixers,
+                     const CgRegionFixNode *grabber = nullptr);
+
+    // restore solver state and pin sets from path, the system must match the saved one;
+    // grabber is released, its anchors belong to the replaced state
+    static void restore(const char *path, MassSpringSolver &solver, const FixerList &fixers,
+                        CgRegionFixNode *grabber = nullptr);
+};
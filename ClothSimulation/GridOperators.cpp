@@ -0,0 +1,100 @@
+#include "GridOperators.h"
+#include "Parallel.h"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cassert>
+
+// Spring order of MassSpringBuilder::uniformGrid, per node (i, j) in row-major order:
+//   interior node    struct right, struct down, shear (i, j)-(i+1, j+1), shear (i+1, j)-(i, j+1),
+//                    bend right if j is even, bend down if i is even
+//   right edge node  struct down, bend down if i is even
+//   last row node    struct right, bend right if j is even
+// The bottom right corner owns no springs.
+
+GridOperators::GridOperators(unsigned int n) : n(n)
+{
+    assert(n % 2 == 1 && n >= 3);
+    even_row = (n - 1) * 5 + (n - 1) / 2 + 2;
+    odd_row = (n - 1) * 4 + (n - 1) / 2 + 1;
+}
+
+unsigned int GridOperators::nodeStart(unsigned int i, unsigned int j) const
+{
+    unsigned int row = (i / 2) * (even_row + odd_row) + (i % 2) * even_row;
+    if (i == n - 1)
+        return row + j + (j + 1) / 2;
+    return row + j * (4 + (i % 2 == 0)) + (j + 1) / 2;
+}
+
+// rows per band of addSpringForces; springs reach at most two rows down, so
+// bands of at least two rows with one band between them share no points
+static const int g_band_rows = 2;
+
+void GridOperators::addSpringForces(float scale, const float *q, const uint8_t *materials,
+                                    const float *rest_lengths, const float *stiffnesses,
+                                    const unsigned char *awake, float *b) const
+{
+    const int n = this->n;
+    const int n_bands = (n + g_band_rows - 1) / g_band_rows;
+    for (int color = 0; color < 2; color++)
+    {
+        parallelFor(0, (n_bands - color + 1) / 2, [&](int t)
+        {
+            const int band = color + 2 * t;
+            const int end = std::min(n, (band + 1) * g_band_rows);
+            for (int i = band * g_band_rows; i < end; i++)
+            {
+                unsigned int k = nodeStart(i, 0);
+                auto spring = [&](unsigned int a, unsigned int c)
+                {
+                    if (awake && !awake[k])
+                    {
+                        k++;
+                        return;
+                    }
+                    Eigen::Vector3f p12(q[3 * a] - q[3 * c], q[3 * a + 1] - q[3 * c + 1], q[3 * a + 2] - q[3 * c + 2]);
+                    p12.normalize();
+                    const uint8_t m = materials[k++];
+                    const Eigen::Vector3f f = (scale * stiffnesses[m] * rest_lengths[m]) * p12;
+                    b[3 * a] += f[0];
+                    b[3 * a + 1] += f[1];
+                    b[3 * a + 2] += f[2];
+                    b[3 * c] -= f[0];
+                    b[3 * c + 1] -= f[1];
+                    b[3 * c + 2] -= f[2];
+                };
+                for (int j = 0; j < n; j++)
+                {
+                    const unsigned int p = n * i + j;
+                    if (i == n - 1)
+                    {
+                        if (j == n - 1)
+                            break;
+                        spring(p, p + 1);
+                        if (j % 2 == 0)
+                            spring(p, p + 2);
+                        continue;
+                    }
+                    if (j == n - 1)
+                    {
+                        spring(p, p + n);
+                        if (i % 2 == 0)
+                            spring(p, p + 2 * n);
+                        continue;
+                    }
+                    spring(p, p + 1);
+                    spring(p, p + n);
+                    spring(p, p + n + 1);
+                    spring(p + n, p + 1);
+                    if (j % 2 == 0)
+                        spring(p, p + 2);
+                    if (i % 2 == 0)
+                        spring(p, p + 2 * n);
+                }
+            }
+        });
+    }
+}
+
+unsigned int GridOperators::gridSize() const { return n; }
+unsigned int GridOperators::springCount() const { return (n - 1) * (5 * n - 2); }
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+// Matrix-free operators for systems built by MassSpringBuilder::uniformGrid
+//
+// The spring topology of an n x n grid is implied by n: every node owns its
+// structural, shearing and bending springs in a fixed order, so the spring
+// index of a node is a closed form of its row and column. The spring step
+// runs as a stencil over the grid without reading the spring list or a sparse
+// matrix; per spring only the material class is read, rest lengths and
+// stiffnesses come from the class tables. It parallelizes over bands of grid
+// rows in two colors, see addSpringForces.
+class GridOperators
+{
+private:
+    unsigned int n;
+    unsigned int even_row, odd_row; // springs of rows with even / odd index, last row excluded
+
+    unsigned int nodeStart(unsigned int i, unsigned int j) const; // index of the first spring of node (i, j)
+
+public:
+    GridOperators(unsigned int n);
+
+    // local step fused with the right hand side of the global step: b += scale * J * d, J the
+    // 3 n_points x 3 n_springs matrix with J(a, k) = s_k, J(b, k) = -s_k for every spring k = (a, b),
+    // d_k = r_k * normalize(q_a - q_b), r_k = rest_lengths[materials[k]], s_k = stiffnesses[materials[k]];
+    // q and b have 3 floats per point, the directions are never stored; springs with awake[k] == 0
+    // are skipped, awake may be nullptr
+    void addSpringForces(float scale, const float *q, const uint8_t *materials, const float *rest_lengths,
+                         const float *stiffnesses, const unsigned char *awake, float *b) const;
+
+    unsigned int gridSize() const;
+    unsigned int springCount() const;
+};
@@ -0,0 +1,213 @@
+#include "ImageWriter.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// IMAGE CODEC
+void ImageCodec::encodePpm(const uint8_t *rgb, unsigned int width, unsigned int height, Bytes &out)
+{
+    char header[64];
+    int n = std::snprintf(header, sizeof(header), "P6\n%u %u\n255\n", width, height);
+    out.assign(header, header + n);
+    out.insert(out.end(), rgb, rgb + 3 * (size_t)width * height);
+}
+
+static uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+{
+    static uint32_t table[256];
+    static bool initialized = false;
+    if (!initialized)
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        initialized = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void putU32(ImageCodec::Bytes &out, uint32_t v)
+{
+    uint8_t b[4] = {(uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+    out.insert(out.end(), b, b + 4);
+}
+
+static void putChunk(ImageCodec::Bytes &out, const char *type, const uint8_t *data, size_t size)
+{
+    putU32(out, (uint32_t)size);
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    putU32(out, crc32(out.data() + start, size + 4));
+}
+
+void ImageCodec::encodePng(const uint8_t *rgb, unsigned int width, unsigned int height, Bytes &out)
+{
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    out.assign(signature, signature + 8);
+
+    // header: 8-bit rgb, no interlace
+    Bytes ihdr;
+    putU32(ihdr, width);
+    putU32(ihdr, height);
+    const uint8_t format[5] = {8, 2, 0, 0, 0};
+    ihdr.insert(ihdr.end(), format, format + 5);
+    putChunk(out, "IHDR", ihdr.data(), ihdr.size());
+
+    // zlib stream of stored blocks over the filtered rows, filter type 0
+    const size_t row = 3 * (size_t)width + 1;
+    const size_t raw_size = row * height;
+    const size_t max_block = 65535;
+    Bytes idat;
+    idat.reserve(2 + raw_size + 5 * (raw_size / max_block + 1) + 4);
+    idat.push_back(0x78);
+    idat.push_back(0x01);
+    uint32_t a = 1, b = 0; // adler32
+    size_t remaining = raw_size, offset = 0;
+    while (remaining > 0)
+    {
+        uint16_t n = (uint16_t)(remaining < max_block ? remaining : max_block);
+        remaining -= n;
+        const uint8_t block[5] = {(uint8_t)(remaining == 0), (uint8_t)n, (uint8_t)(n >> 8),
+                                  (uint8_t)~n, (uint8_t)(~n >> 8)};
+        idat.insert(idat.end(), block, block + 5);
+        for (size_t end = offset + n; offset < end; offset++)
+        {
+            size_t column = offset % row;
+            uint8_t byte = column == 0 ? 0 : rgb[(offset / row) * (row - 1) + column - 1];
+            idat.push_back(byte);
+            a += byte;
+            b += a;
+            if ((offset & 4095) == 4095) // well below the 5552 byte overflow bound
+            {
+                a %= 65521;
+                b %= 65521;
+            }
+        }
+    }
+    putU32(idat, ((b % 65521) << 16) | (a % 65521));
+    putChunk(out, "IDAT", idat.data(), idat.size());
+    putChunk(out, "IEND", nullptr, 0);
+}
+
+// IMAGE WRITER
+ImageWriter::ImageWriter(const char *pattern, unsigned int width, unsigned int height, unsigned int queue_length)
+    : pattern(pattern), width(width), height(height), n_images(0),
+      slots(queue_length, Image(3 * (size_t)width * height)), head(0), count(0),
+      closing(false), failed(false), written_bytes(0), writer_seconds(0.0), stall_seconds(0.0), stalls(0)
+{
+    std::string p(pattern);
+    if (p.size() >= 4 && p.compare(p.size() - 4, 4, ".png") == 0)
+        png = true;
+    else if (p.size() >= 4 && p.compare(p.size() - 4, 4, ".ppm") == 0)
+        png = false;
+    else
+        throw std::runtime_error("Image pattern must end in .png or .ppm: " + p);
+    writer = std::thread(&ImageWriter::run, this);
+}
+
+ImageWriter::~ImageWriter() { close(); }
+
+uint8_t *ImageWriter::acquire()
+{
+    // single producer: the slot after the queued ones is not touched by the writer
+    std::unique_lock<std::mutex> lock(mutex);
+    if (count == slots.size())
+    {
+        // back-pressure: the writer can't keep up, wait for a free slot
+        auto start = std::chrono::steady_clock::now();
+        not_full.wait(lock, [this] { return count < slots.size(); });
+        stall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stalls++;
+    }
+    return slots[(head + count) % slots.size()].data();
+}
+
+void ImageWriter::submit()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    count++;
+    n_images++;
+    not_empty.notify_one();
+}
+
+void ImageWriter::run()
+{
+    ImageCodec::Bytes encoded;
+    unsigned int index = 0;
+
+    while (true)
+    {
+        // wait for an image, the slot stays owned by the writer until it is encoded
+        Image *image;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [this] { return count > 0 || closing; });
+            if (count == 0)
+                return;
+            image = &slots[head];
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (!failed)
+        {
+            if (png)
+                ImageCodec::encodePng(image->data(), width, height, encoded);
+            else
+                ImageCodec::encodePpm(image->data(), width, height, encoded);
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            head = (head + 1) % slots.size();
+            count--;
+            not_full.notify_one();
+        }
+
+        // after a write error images are dropped so acquire() never blocks forever
+        if (failed)
+            continue;
+
+        char path[4096];
+        std::snprintf(path, sizeof(path), pattern.c_str(), index++);
+        FILE *file = std::fopen(path, "wb");
+        if (!file || std::fwrite(encoded.data(), 1, encoded.size(), file) != encoded.size())
+        {
+            std::cerr << "Failed to write " << path << ", image output stopped." << std::endl;
+            failed = true;
+        }
+        else
+            written_bytes += encoded.size();
+        if (file)
+            std::fclose(file);
+        writer_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void ImageWriter::close()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (closing)
+            return;
+        closing = true;
+        not_empty.notify_one();
+    }
+    writer.join();
+}
+
+void ImageWriter::printStats() const
+{
+    std::cout << n_images << " images, " << written_bytes / (1024.0 * 1024.0) << " MiB written, "
+              << "writer " << writer_seconds << " s ("
+              << (writer_seconds > 0.0 ? n_images / writer_seconds : 0.0) << " images/s), "
+              << stalls << " stalls (" << stall_seconds << " s)" << std::endl;
+}
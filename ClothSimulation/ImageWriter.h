@@ -0,0 +1,64 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Image codec, 8-bit RGB
+class ImageCodec
+{
+public:
+    typedef std::vector<uint8_t> Bytes;
+
+    // binary PPM (P6)
+    static void encodePpm(const uint8_t *rgb, unsigned int width, unsigned int height, Bytes &out);
+
+    // PNG with stored (uncompressed) deflate blocks, encoding is a copy plus checksums
+    static void encodePng(const uint8_t *rgb, unsigned int width, unsigned int height, Bytes &out);
+};
+
+// Asynchronous image sequence writer
+//
+// The producer fills a preallocated slot from acquire() and hands it over with
+// submit(), a writer thread encodes and writes the images in order. File names
+// come from a printf pattern with one integer, e.g. "frames/cloth%04d.png";
+// the extension selects PNG or PPM.
+class ImageWriter
+{
+private:
+    typedef std::vector<uint8_t> Image;
+
+    std::string pattern;
+    bool png;                            // else ppm
+    unsigned int width, height;
+    unsigned int n_images;               // images submitted
+
+    // bounded image queue
+    std::vector<Image> slots;            // preallocated RGB images
+    unsigned int head, count;            // first queued slot, number of queued slots
+    bool closing;
+    bool failed;                         // set by the writer after a write error
+    std::mutex mutex;
+    std::condition_variable not_empty, not_full;
+    std::thread writer;
+
+    // statistics
+    uint64_t written_bytes;
+    double writer_seconds;               // time spent encoding and writing
+    double stall_seconds;                // time acquire() waited for a free slot
+    unsigned int stalls;
+
+    void run(); // writer thread
+
+public:
+    ImageWriter(const char *pattern, unsigned int width, unsigned int height, unsigned int queue_length = 4);
+    ~ImageWriter();
+
+    uint8_t *acquire(); // free slot for the next image, width * height * 3 bytes top row first, blocks while the queue is full
+    void submit();      // queue the acquired slot
+    void close();       // write the queued images
+
+    void printStats() const;
+};
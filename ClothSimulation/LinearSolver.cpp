@@ -0,0 +1,191 @@
+#include "LinearSolver.h"
+#include "Multigrid.h"
+#include "Supernodal.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// LINEAR SOLVER
+const char *LinearSolver::name(Type type)
+{
+    switch (type)
+    {
+    case Cholesky:
+        return "cholesky";
+    case Banded:
+        return "banded";
+    case Multigrid:
+        return "multigrid";
+    case Supernodal:
+        return "supernodal";
+    }
+    return "unknown";
+}
+
+bool LinearSolver::parse(const std::string &name, Type &type)
+{
+    for (Type t : {Cholesky, Banded, Multigrid, Supernodal})
+    {
+        if (name == LinearSolver::name(t))
+        {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+LinearSolver *LinearSolver::create(Type type, unsigned int grid_n)
+{
+    switch (type)
+    {
+    case Cholesky:
+        return new CholeskySolver();
+    case Banded:
+        return new BandedCholeskySolver();
+    case Multigrid:
+        if (grid_n == 0)
+            throw std::runtime_error("The multigrid solver needs a system built by MassSpringBuilder::uniformGrid");
+        return new MultigridSolver(grid_n);
+    case Supernodal:
+        return new SupernodalCholeskySolver(grid_n);
+    }
+    throw std::runtime_error("Unknown linear solver");
+}
+
+// CHOLESKY SOLVER
+void CholeskySolver::factor(const SparseMatrix &A)
+{
+    llt.compute(A);
+    if (llt.info() != Eigen::Success)
+        throw std::runtime_error("System matrix is not positive definite");
+    work.resize(llt.rows(), 3);
+}
+
+void CholeskySolver::solve(const float *b, float *x)
+{
+    // points are rows of the n x 3 coordinate matrices; the permutations are
+    // applied out of place, Eigen's in-place permutation allocates a mask
+    typedef Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor> Coordinates;
+    const Eigen::Index n = llt.rows();
+    work = llt.permutationP() * Eigen::Map<const Coordinates>(b, n, 3);
+    llt.matrixL().solveInPlace(work);
+    llt.matrixU().solveInPlace(work);
+    Eigen::Map<Coordinates>(x, n, 3) = llt.permutationPinv() * work;
+}
+
+// BANDED CHOLESKY SOLVER
+BandedCholeskySolver::BandedCholeskySolver() : n(0), bandwidth(0) {}
+
+float *BandedCholeskySolver::row(unsigned int i, unsigned int k)
+{
+    return band.data() + (size_t)i * (bandwidth + 1) + k + bandwidth - i;
+}
+
+void BandedCholeskySolver::factor(const SparseMatrix &A)
+{
+    n = A.rows();
+    bandwidth = 0;
+    for (Eigen::Index c = 0; c < A.outerSize(); c++)
+    {
+        for (SparseMatrix::InnerIterator it(A, c); it; ++it)
+            bandwidth = std::max(bandwidth, (unsigned int)std::max<Eigen::Index>(it.row() - it.col(), 0));
+    }
+    const unsigned int p = bandwidth;
+    band.assign((size_t)n * (p + 1), 0.0f);
+    work.resize(3 * (size_t)n);
+    for (Eigen::Index c = 0; c < A.outerSize(); c++)
+    {
+        for (SparseMatrix::InnerIterator it(A, c); it; ++it)
+        {
+            if (it.row() >= it.col())
+                *row(it.row(), it.col()) = it.value();
+        }
+    }
+
+    // row by row, L(i, j) = (A(i, j) - L(i, 0:j) . L(j, 0:j)) / L(j, j)
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const unsigned int lo = i > p ? i - p : 0;
+        float *li = row(i, lo);
+        for (unsigned int j = lo; j <= i; j++)
+        {
+            const float *lj = row(j, lo);
+            const unsigned int m = j - lo;
+            float dot = 0.0f;
+#pragma omp simd reduction(+ : dot)
+            for (unsigned int t = 0; t < m; t++)
+                dot += li[t] * lj[t];
+
+            float s = li[m] - dot;
+            if (j < i)
+                li[m] = s / lj[m];
+            else
+            {
+                if (!(s > 0.0f))
+                    throw std::runtime_error("System matrix is not positive definite");
+                li[m] = std::sqrt(s);
+            }
+        }
+    }
+}
+
+void BandedCholeskySolver::solve(const float *b, float *x)
+{
+    const unsigned int p = bandwidth;
+    float *x0 = work.data(), *x1 = x0 + n, *x2 = x1 + n;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        x0[i] = b[3 * i];
+        x1[i] = b[3 * i + 1];
+        x2[i] = b[3 * i + 2];
+    }
+
+    // L y = b
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const unsigned int lo = i > p ? i - p : 0;
+        const float *li = row(i, lo);
+        const unsigned int m = i - lo;
+        const float *y0 = x0 + lo, *y1 = x1 + lo, *y2 = x2 + lo;
+        float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f;
+#pragma omp simd reduction(+ : s0, s1, s2)
+        for (unsigned int t = 0; t < m; t++)
+        {
+            s0 += li[t] * y0[t];
+            s1 += li[t] * y1[t];
+            s2 += li[t] * y2[t];
+        }
+        x0[i] = (x0[i] - s0) / li[m];
+        x1[i] = (x1[i] - s1) / li[m];
+        x2[i] = (x2[i] - s2) / li[m];
+    }
+
+    // L^T x = y, by rows of L: once x(i) is known, remove it from the rows above
+    for (unsigned int i = n; i-- > 0;)
+    {
+        const unsigned int lo = i > p ? i - p : 0;
+        const float *li = row(i, lo);
+        const unsigned int m = i - lo;
+        const float v0 = x0[i] /= li[m];
+        const float v1 = x1[i] /= li[m];
+        const float v2 = x2[i] /= li[m];
+        float *y0 = x0 + lo, *y1 = x1 + lo, *y2 = x2 + lo;
+#pragma omp simd
+        for (unsigned int t = 0; t < m; t++)
+        {
+            y0[t] -= li[t] * v0;
+            y1[t] -= li[t] * v1;
+            y2[t] -= li[t] * v2;
+        }
+    }
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        x[3 * i] = x0[i];
+        x[3 * i + 1] = x1[i];
+        x[3 * i + 2] = x2[i];
+    }
+}
+
+unsigned int BandedCholeskySolver::bandWidth() const { return bandwidth; }
@@ -0,0 +1,75 @@
+#pragma once
+#include <Eigen/Sparse>
+#include <string>
+#include <vector>
+
+// Linear solver for the global step, (M + h^2 L) x = b
+//
+// The x, y and z coordinates are not coupled and share the same scalar
+// matrix A = M + h^2 L with one row per point, so solvers factor A only and
+// solve the three coordinates as three right hand sides.
+class LinearSolver
+{
+protected:
+    typedef Eigen::SparseMatrix<float> SparseMatrix;
+
+public:
+    enum Type
+    {
+        Cholesky,  // sparse Cholesky, Eigen::SimplicialLLT
+        Banded,    // dense band Cholesky, for row-major grids
+        Multigrid, // geometric multigrid, grid systems only
+        Supernodal // supernodal multifrontal Cholesky, nested dissection on grids
+    };
+
+    static const char *name(Type type);
+    static bool parse(const std::string &name, Type &type);
+    static LinearSolver *create(Type type, unsigned int grid_n); // grid_n as in mass_spring_system
+
+    virtual ~LinearSolver() {}
+
+    // A is n_points x n_points, throws std::runtime_error if A is not positive definite
+    virtual void factor(const SparseMatrix &A) = 0;
+
+    // b and x have 3 floats per point, x holds the previous solution on entry
+    virtual void solve(const float *b, float *x) = 0;
+};
+
+// Generic sparse Cholesky with fill-reducing ordering
+class CholeskySolver : public LinearSolver
+{
+private:
+    Eigen::SimplicialLLT<SparseMatrix> llt;
+    Eigen::MatrixXf work; // right hand sides by coordinate, n x 3
+
+public:
+    virtual void factor(const SparseMatrix &A);
+    virtual void solve(const float *b, float *x);
+};
+
+// Band Cholesky
+//
+// With row-major grid numbering A is banded, bending springs reach two rows
+// so the bandwidth is 2n for an n x n grid. The factor is stored densely by
+// rows within the band, so factorization and triangular solves stream through
+// contiguous memory with no index arrays and no symbolic phase. The inner
+// loops are dot products and axpys over one band row; the x, y and z right
+// hand sides are solved together against the same row.
+class BandedCholeskySolver : public LinearSolver
+{
+private:
+    unsigned int n;            // unknowns per coordinate, one per point
+    unsigned int bandwidth;    // p, L(i, k) = 0 for i - k > p
+    std::vector<float> band;   // L(i, k) at band[i * (p + 1) + k - i + p]
+    std::vector<float> work;   // right hand sides by coordinate, 3 * n
+
+    float *row(unsigned int i, unsigned int k); // band row i starting at column k >= i - p
+
+public:
+    BandedCholeskySolver();
+
+    virtual void factor(const SparseMatrix &A);
+    virtual void solve(const float *b, float *x);
+
+    unsigned int bandWidth() const;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Triple buffer for handing the latest state from one writer to one reader
+//
+// The writer fills writeBuffer() and publishes it, the reader calls update()
+// and reads readBuffer(). Neither side ever waits: the writer always owns one
+// buffer, the reader one, and the third is swapped atomically. Frames the
+// reader never picked up are overwritten.
+template <typename T>
+class TripleBuffer
+{
+private:
+    static const unsigned int dirty = 4; // set when the shared buffer holds an unread frame
+
+    T buffers[3];
+    std::atomic<unsigned int> shared; // index of the shared buffer | dirty
+    unsigned int write_index;         // owned by the writer
+    unsigned int read_index;          // owned by the reader
+
+public:
+    TripleBuffer() : shared(1), write_index(0), read_index(2) {}
+
+    // initialize all three buffers, not thread safe
+    void reset(const T &value)
+    {
+        for (T &buffer : buffers)
+            buffer = value;
+    }
+
+    // writer
+    T &writeBuffer() { return buffers[write_index]; }
+    void publish()
+    {
+        write_index = shared.exchange(write_index | dirty, std::memory_order_acq_rel) & 3;
+    }
+
+    // reader, returns true if a new frame was picked up
+    bool update()
+    {
+        if (!(shared.load(std::memory_order_relaxed) & dirty))
+            return false;
+        read_index = shared.exchange(read_index, std::memory_order_acq_rel) & 3;
+        return true;
+    }
+    const T &readBuffer() const { return buffers[read_index]; }
+};
+
+// Bounded single-producer single-consumer queue, capacity must be a power of two
+template <typename T, size_t capacity>
+class SpscQueue
+{
+private:
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+    T items[capacity];
+    alignas(64) std::atomic<size_t> head; // next item to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail; // next free slot, written by the producer
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // producer, returns false if the queue is full
+    bool push(const T &item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == capacity)
+            return false;
+        items[t & (capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer, returns false if the queue is empty
+    bool pop(T &item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        item = items[h & (capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
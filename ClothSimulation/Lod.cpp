@@ -0,0 +1,59 @@
+#include "Lod.h"
+#include <algorithm>
+#include <cmath>
+
+LodSelector::LodSelector(float fov_y, unsigned int viewport_height, float max_cell_pixels, float hysteresis,
+                         float min_coverage)
+    : tan_half_fov(std::tan(0.5f * fov_y)), viewport_height(viewport_height),
+      max_cell_pixels(max_cell_pixels), hysteresis(hysteresis), min_coverage(min_coverage), current(0),
+      last_distance(0.0f), last_coverage(0.0f) {}
+
+void LodSelector::setViewport(unsigned int height) { viewport_height = height; }
+
+float LodSelector::cellPixels(float spacing, float distance) const
+{
+    return spacing * viewport_height / (2.0f * distance * tan_half_fov);
+}
+
+unsigned int LodSelector::select(const float *modelview, const Scene &scene)
+{
+    // bounding sphere of the displayed mesh
+    Mesh &mesh = *scene.mesh;
+    Eigen::Map<const Eigen::Matrix3Xf> points(mesh.vbuff(), 3, mesh.n_vertices());
+    const Eigen::Vector3f lo = points.rowwise().minCoeff(), hi = points.rowwise().maxCoeff();
+    const Eigen::Vector3f center = 0.5f * (lo + hi);
+    const float radius = 0.5f * (hi - lo).norm();
+
+    // view space, the eye is at the origin
+    Eigen::Map<const Eigen::Matrix4f> mv(modelview);
+    const Eigen::Vector3f eye_center = (mv * center.homogeneous()).head<3>();
+    last_distance = eye_center.norm();
+    last_coverage = last_distance > radius ? radius / (last_distance * tan_half_fov) : 1.0f;
+    const float nearest = std::max(last_distance - radius, 1e-3f);
+
+    // too small on screen for detail to show
+    const unsigned int coarsest = scene.levelCount() - 1;
+    if (coverage() < (current == coarsest ? min_coverage * hysteresis : min_coverage))
+    {
+        current = coarsest;
+        return current;
+    }
+
+    // coarsest level fine enough, coarsening only with margin
+    unsigned int level = 0;
+    for (unsigned int k = scene.levelCount(); k-- > 0;)
+    {
+        if (cellPixels(scene.levelSpacing(k), nearest) <= max_cell_pixels)
+        {
+            level = k;
+            break;
+        }
+    }
+    while (level > current && cellPixels(scene.levelSpacing(level), nearest) > max_cell_pixels / hysteresis)
+        level--;
+    current = level;
+    return level;
+}
+
+float LodSelector::distance() const { return last_distance; }
+float LodSelector::coverage() const { return std::min(last_coverage, 1.0f); }
@@ -0,0 +1,43 @@
+#pragma once
+#include "Scene.h"
+
+// Camera driven level of detail for scenes with several levels
+//
+// select() bounds the displayed cloth with a sphere and measures it in view
+// space: its distance from the eye and its screen coverage, the fraction of
+// the viewport height its diameter spans. A level is fine enough while its
+// grid spacing, at the distance of the nearest point of the sphere, projects
+// to at most max_cell_pixels; the coarsest such level is selected. A cloth
+// covering less than min_coverage of the viewport is too small on screen for
+// any detail to show and gets the coarsest level whatever its spacing.
+// Switching to a coarser level waits until that level is below
+// max_cell_pixels / hysteresis, and leaving the coarsest level for low
+// coverage until the coverage is above min_coverage * hysteresis, so a camera
+// resting near a threshold does not make the cloth switch back and forth.
+class LodSelector
+{
+private:
+    float tan_half_fov;           // tan(fov_y / 2) of the perspective projection
+    unsigned int viewport_height; // pixels
+    float max_cell_pixels;
+    float hysteresis;
+    float min_coverage;
+    unsigned int current;         // last selected level
+    float last_distance;
+    float last_coverage;
+
+    float cellPixels(float spacing, float distance) const;
+
+public:
+    LodSelector(float fov_y, unsigned int viewport_height,
+                float max_cell_pixels = 8.0f, float hysteresis = 1.25f, float min_coverage = 0.05f);
+
+    void setViewport(unsigned int height);
+
+    // level for the scene seen through a column-major modelview matrix, as
+    // glm::value_ptr returns it, does not switch the scene
+    unsigned int select(const float *modelview, const Scene &scene);
+
+    float distance() const; // eye to bounding sphere center at the last select()
+    float coverage() const; // screen coverage at the last select()
+};
@@ -1,5 +1,9 @@
 #include "MassSpringSolver.h"
+#include "Parallel.h"
+#include "Sleep.h"
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 // SYSTEM
 mass_spring_system::mass_spring_system(
@@ -7,119 +11,221 @@ mass_spring_system::mass_spring_system(
     unsigned int n_springs, // number of springs
     float time_step,        // time step
     EdgeList spring_list,   // spring edge list
-    VectorXf rest_lengths,  // spring rest lengths
-    VectorXf stiffnesses,   // spring stiffnesses
+    MaterialList materials, // spring material classes
+    VectorXf rest_lengths,  // rest length per material class
+    VectorXf stiffnesses,   // stiffness per material class
     VectorXf masses,        // points masses
     VectorXf fext,          // external forces
     float damping_factor    // damping factor
     ) : n_points(n_points), n_springs(n_springs), time_step(time_step),
-        spring_list(spring_list), rest_lengths(rest_lengths),
+        spring_list(spring_list), materials(materials), rest_lengths(rest_lengths),
         stiffnesses(stiffnesses), masses(masses),
-        fext(fext), damping_factor(damping_factor)
+        fext(fext), damping_factor(damping_factor), grid_n(0), sleep(nullptr)
 {
+    assert(this->materials.size() == n_springs && rest_lengths.size() == stiffnesses.size() &&
+           rest_lengths.size() <= 256);
 }
 
 // SOLVER
-MassSpringSolver::MassSpringSolver(mass_spring_system *system, float *vbuff)
-    : system(system), current_state(vbuff, system->n_points * 3),
-      prev_state(current_state), spring_directions(system->n_springs * 3)
+MassSpringSolver::MassSpringSolver(mass_spring_system *system, float *vbuff,
+                                   LinearSolver::Type solver_type)
+    : system(system), system_matrix(nullptr), grid(nullptr), current_state(vbuff, system->n_points * 3),
+      prev_state(current_state),
+      inertial_term(system->n_points * 3), rhs(system->n_points * 3), sleeping_version(0),
+      iterate_state(system->n_points * 3),
+      n_steps(0), n_iterations(0), sleep(nullptr)
 {
 
     float h2 = system->time_step * system->time_step; // shorthand
+    scaled_fext = h2 * system->fext;
 
-    // compute M, L, J
-    TripletList LTriplets, JTriplets;
-    // L
-    L.resize(3 * system->n_points, 3 * system->n_points);
-    unsigned int k = 0; // spring counter
+    // system matrix M + h^2 L, scalar as it doesn't couple coordinates; the
+    // columns are reserved up front so large grids need no triplet list
+    Eigen::VectorXi column_sizes = Eigen::VectorXi::Ones(system->n_points);
     for (Edge &i : system->spring_list)
     {
-        for (int j = 0; j < 3; j++)
-        {
-            LTriplets.push_back(
-                Triplet(3 * i.first + j, 3 * i.first + j, 1 * system->stiffnesses[k]));
-            LTriplets.push_back(
-                Triplet(3 * i.first + j, 3 * i.second + j, -1 * system->stiffnesses[k]));
-            LTriplets.push_back(
-                Triplet(3 * i.second + j, 3 * i.first + j, -1 * system->stiffnesses[k]));
-            LTriplets.push_back(
-                Triplet(3 * i.second + j, 3 * i.second + j, 1 * system->stiffnesses[k]));
-        }
-        k++;
+        column_sizes[i.first]++;
+        column_sizes[i.second]++;
     }
-    L.setFromTriplets(LTriplets.begin(), LTriplets.end());
-
-    // J
-    J.resize(3 * system->n_points, 3 * system->n_springs);
-    k = 0; // spring counter
+    SparseMatrix A(system->n_points, system->n_points);
+    A.reserve(column_sizes);
+    for (unsigned int i = 0; i < system->n_points; i++)
+        A.insert(i, i) = system->masses[i];
+    unsigned int k = 0; // spring counter
     for (Edge &i : system->spring_list)
     {
-        for (unsigned int j = 0; j < 3; j++)
-        {
-            JTriplets.push_back(
-                Triplet(3 * i.first + j, 3 * k + j, 1 * system->stiffnesses[k]));
-            JTriplets.push_back(
-                Triplet(3 * i.second + j, 3 * k + j, -1 * system->stiffnesses[k]));
-        }
-        k++;
+        float s = h2 * system->stiffnesses[system->materials[k++]];
+        A.coeffRef(i.first, i.first) += s;
+        A.coeffRef(i.first, i.second) -= s;
+        A.coeffRef(i.second, i.first) -= s;
+        A.coeffRef(i.second, i.second) += s;
     }
-    J.setFromTriplets(JTriplets.begin(), JTriplets.end());
+    A.makeCompressed();
 
-    // M
-    TripletList MTriplets;
-    M.resize(3 * system->n_points, 3 * system->n_points);
-    for (unsigned int i = 0; i < system->n_points; i++)
+    // spring partition of the local step, rows of the grid for grid systems,
+    // else a greedy edge coloring so springs of a color scatter without races
+    if (system->grid_n > 0)
+        grid = new GridOperators(system->grid_n);
+    else
     {
-        for (int j = 0; j < 3; j++)
+        std::vector<std::vector<unsigned int>> point_colors(system->n_points);
+        std::vector<unsigned int> spring_colors(system->n_springs);
+        unsigned int n_colors = 0;
+        k = 0; // spring counter
+        for (Edge &i : system->spring_list)
         {
-            MTriplets.push_back(Triplet(3 * i + j, 3 * i + j, system->masses[i]));
+            std::vector<unsigned int> &first = point_colors[i.first], &second = point_colors[i.second];
+            unsigned int c = 0;
+            while (std::find(first.begin(), first.end(), c) != first.end() ||
+                   std::find(second.begin(), second.end(), c) != second.end())
+                c++;
+            first.push_back(c);
+            second.push_back(c);
+            spring_colors[k++] = c;
+            n_colors = std::max(n_colors, c + 1);
         }
+        color_offsets.assign(n_colors + 1, 0);
+        for (unsigned int c : spring_colors)
+            color_offsets[c + 1]++;
+        for (unsigned int c = 0; c < n_colors; c++)
+            color_offsets[c + 1] += color_offsets[c];
+        colored_springs.resize(system->n_springs);
+        std::vector<unsigned int> next(color_offsets.begin(), color_offsets.end() - 1);
+        for (k = 0; k < system->n_springs; k++)
+            colored_springs[next[spring_colors[k]]++] = k;
     }
-    M.setFromTriplets(MTriplets.begin(), MTriplets.end());
 
     // pre-factor system matrix
-    SparseMatrix A = M + h2 * L;
-    system_matrix.compute(A);
+    system_matrix = LinearSolver::create(solver_type, system->grid_n);
+    system_matrix->factor(A);
 }
 
-void MassSpringSolver::globalStep()
+MassSpringSolver::~MassSpringSolver()
 {
-    float h2 = system->time_step * system->time_step; // shorthand
-
-    // compute right hand side
-    VectorXf b = inertial_term + h2 * J * spring_directions + h2 * system->fext;
+    delete system_matrix;
+    delete grid;
+    if (sleep)
+    {
+        system->sleep = nullptr;
+        delete sleep;
+    }
+}
 
+void MassSpringSolver::globalStep()
+{
     // solve system and update state
-    current_state = system_matrix.solve(b);
+    system_matrix->solve(rhs.data(), current_state.data());
+
+    // sleeping points stay where they fell asleep, like pins
+    if (sleep)
+    {
+        const unsigned char *awake = sleep->pointMask();
+        for (unsigned int i = 0; i < system->n_points; i++)
+        {
+            if (!awake[i])
+                current_state.segment<3>(3 * i) = prev_state.segment<3>(3 * i);
+        }
+    }
 }
 
 void MassSpringSolver::localStep()
 {
-    unsigned int j = 0;
-    for (Edge &i : system->spring_list)
+    float h2 = system->time_step * system->time_step; // shorthand
+
+    // right hand side M * y + h^2 * fext + h^2 * J * d in place, each spring
+    // adds its projection straight to its two points; springs between
+    // sleeping points do not move, their part is added as it was when they
+    // fell asleep
+    rhs = inertial_term + scaled_fext;
+    const unsigned char *awake = nullptr;
+    if (sleep)
+    {
+        rhs += sleeping_forces;
+        awake = sleep->springMask();
+    }
+    const uint8_t *materials = system->materials.data();
+    const float *rest_lengths = system->rest_lengths.data();
+    const float *stiffnesses = system->stiffnesses.data();
+    if (grid)
     {
-        Vector3f p12(
-            current_state[3 * i.first + 0] - current_state[3 * i.second + 0],
-            current_state[3 * i.first + 1] - current_state[3 * i.second + 1],
-            current_state[3 * i.first + 2] - current_state[3 * i.second + 2]);
-
-        p12.normalize();
-        spring_directions[3 * j + 0] = system->rest_lengths[j] * p12[0];
-        spring_directions[3 * j + 1] = system->rest_lengths[j] * p12[1];
-        spring_directions[3 * j + 2] = system->rest_lengths[j] * p12[2];
-        j++;
+        grid->addSpringForces(h2, current_state.data(), materials, rest_lengths, stiffnesses, awake, rhs.data());
+        return;
+    }
+
+    for (size_t c = 0; c + 1 < color_offsets.size(); c++)
+    {
+        const int begin = color_offsets[c], end = color_offsets[c + 1];
+        parallelFor(begin, end, [&](int t)
+        {
+            const unsigned int k = colored_springs[t];
+            if (awake && !awake[k])
+                return;
+            const Edge &i = system->spring_list[k];
+            Vector3f p12 = current_state.segment<3>(3 * i.first) - current_state.segment<3>(3 * i.second);
+            p12.normalize();
+            const uint8_t m = materials[k];
+            const Vector3f f = (h2 * stiffnesses[m] * rest_lengths[m]) * p12;
+            rhs.segment<3>(3 * i.first) += f;
+            rhs.segment<3>(3 * i.second) -= f;
+        });
     }
 }
 
-void MassSpringSolver::solve(unsigned int n)
+void MassSpringSolver::beginStep()
 {
     float a = system->damping_factor; // shorthand
 
-    // update inertial term
-    inertial_term = M * ((a + 1) * (current_state)-a * prev_state);
+    // regions from the last time step, sleeping points are at rest
+    if (sleep)
+    {
+        sleep->update(current_state.data(), prev_state.data());
+        const unsigned char *awake = sleep->pointMask();
+        for (unsigned int i = 0; i < system->n_points; i++)
+        {
+            if (!awake[i])
+                prev_state.segment<3>(3 * i) = current_state.segment<3>(3 * i);
+        }
+
+        // forces of the sleeping springs, their ends stay where they are now;
+        // springs woken by a constraint since the last step drop out here
+        if (sleep->springVersion() != sleeping_version)
+        {
+            sleeping_version = sleep->springVersion();
+            const float h2 = system->time_step * system->time_step;
+            const unsigned char *awake_springs = sleep->springMask();
+            sleeping_forces.setZero();
+            for (unsigned int k = 0; k < system->n_springs; k++)
+            {
+                if (awake_springs[k])
+                    continue;
+                const Edge &i = system->spring_list[k];
+                Vector3f p12 = current_state.segment<3>(3 * i.first) - current_state.segment<3>(3 * i.second);
+                p12.normalize();
+                const uint8_t m = system->materials[k];
+                const Vector3f f = (h2 * system->stiffnesses[m] * system->rest_lengths[m]) * p12;
+                sleeping_forces.segment<3>(3 * i.first) += f;
+                sleeping_forces.segment<3>(3 * i.second) -= f;
+            }
+        }
+    }
+
+    // update inertial term, M is diagonal with the point masses
+    inertial_term = (a + 1) * current_state - a * prev_state;
+    Eigen::Map<Eigen::Matrix3Xf>(inertial_term.data(), 3, system->n_points).array().rowwise() *=
+        system->masses.transpose().array();
 
     // save current state in previous state
     prev_state = current_state;
+}
+
+void MassSpringSolver::solve(unsigned int n)
+{
+    if (sleep && sleep->allAsleep())
+    {
+        n_steps++;
+        return;
+    }
+    beginStep();
 
     // perform steps
     for (unsigned int i = 0; i < n; i++)
@@ -127,13 +233,69 @@ void MassSpringSolver::solve(unsigned int n)
         localStep();
         globalStep();
     }
+    n_steps++;
+    n_iterations += n;
 }
 
+unsigned int MassSpringSolver::solveAdaptive(unsigned int min_iter, unsigned int max_iter,
+                                             float tol, float abs_tol)
+{
+    assert(min_iter >= 1 && min_iter <= max_iter);
+    if (sleep && sleep->allAsleep())
+    {
+        n_steps++;
+        return 0;
+    }
+    beginStep();
+
+    // abs_tol is an RMS value per coordinate, scale it to a vector norm
+    const float abs_threshold = abs_tol * std::sqrt((float)current_state.size());
+    unsigned int i = 0;
+    while (i < max_iter)
+    {
+        iterate_state = current_state;
+        localStep();
+        globalStep();
+        i++;
+        if (i < min_iter)
+            continue;
+
+        // converged when the last iteration moved the state little compared to the time step
+        float change = (current_state - iterate_state).norm();
+        float motion = (current_state - prev_state).norm();
+        if (change <= tol * motion + abs_threshold)
+            break;
+    }
+    n_steps++;
+    n_iterations += i;
+    return i;
+}
+
+float MassSpringSolver::averageIterations() const
+{
+    return n_steps > 0 ? (float)n_iterations / n_steps : 0.0f;
+}
+
+void MassSpringSolver::enableSleeping(float sleep_speed, unsigned int quiet_steps)
+{
+    delete sleep;
+    sleep = new RegionSleep(system, sleep_speed, quiet_steps);
+    system->sleep = sleep;
+    sleeping_forces = VectorXf::Zero(3 * system->n_points);
+    sleeping_version = sleep->springVersion();
+}
+
+RegionSleep *MassSpringSolver::getSleep() { return sleep; }
+
 void MassSpringSolver::timedSolve(unsigned int ms)
 {
     // todo
 }
 
+mass_spring_system *MassSpringSolver::getSystem() { return system; }
+float *MassSpringSolver::currentState() { return current_state.data(); }
+float *MassSpringSolver::previousState() { return prev_state.data(); }
+
 // BUILDER
 void MassSpringBuilder::uniformGrid(
     unsigned int n,
@@ -155,7 +317,7 @@ void MassSpringBuilder::uniformGrid(
     unsigned int n_springs = (n - 1) * (5 * n - 2);
 
     // build mass list
-    VectorXf masses(mass * VectorXf::Ones(n_springs));
+    VectorXf masses(mass * VectorXf::Ones(n_points));
 
     // build spring list and spring parameters
     EdgeList spring_list(n_springs);
@@ -163,8 +325,15 @@ void MassSpringBuilder::uniformGrid(
     shearI.reserve(2 * (n - 1) * (n - 1));
     bendI.reserve(n * (n - 1));
 
-    VectorXf rest_lengths(n_springs);
-    VectorXf stiffnesses(n_springs);
+    // material classes, springs only store their class
+    mass_spring_system::MaterialList materials(n_springs);
+    VectorXf rest_lengths(3);
+    VectorXf stiffnesses(3);
+    rest_lengths[Structural] = rest_length;
+    rest_lengths[Shearing] = root2 * rest_length;
+    rest_lengths[Bending] = 2 * rest_length;
+    stiffnesses.setConstant(stiffness);
+
     unsigned int k = 0; // spring counter
     for (unsigned int i = 0; i < n; i++)
     {
@@ -180,16 +349,14 @@ void MassSpringBuilder::uniformGrid(
             {
                 // structural spring
                 spring_list[k] = Edge(n * i + j, n * i + j + 1);
-                rest_lengths[k] = rest_length;
-                stiffnesses[k] = stiffness;
+                materials[k] = Structural;
                 structI.push_back(k++);
 
                 // bending spring
                 if (j % 2 == 0)
                 {
                     spring_list[k] = Edge(n * i + j, n * i + j + 2);
-                    rest_lengths[k] = 2 * rest_length;
-                    stiffnesses[k] = stiffness;
+                    materials[k] = Bending;
                     bendI.push_back(k++);
                 }
                 continue;
@@ -200,16 +367,14 @@ void MassSpringBuilder::uniformGrid(
             {
                 // structural spring
                 spring_list[k] = Edge(n * i + j, n * (i + 1) + j);
-                rest_lengths[k] = rest_length;
-                stiffnesses[k] = stiffness;
+                materials[k] = Structural;
                 structI.push_back(k++);
 
                 // bending spring
                 if (i % 2 == 0)
                 {
                     spring_list[k] = Edge(n * i + j, n * (i + 2) + j);
-                    rest_lengths[k] = 2 * rest_length;
-                    stiffnesses[k] = stiffness;
+                    materials[k] = Bending;
                     bendI.push_back(k++);
                 }
                 continue;
@@ -217,39 +382,33 @@ void MassSpringBuilder::uniformGrid(
 
             // structural springs
             spring_list[k] = Edge(n * i + j, n * i + j + 1);
-            rest_lengths[k] = rest_length;
-            stiffnesses[k] = stiffness;
+            materials[k] = Structural;
             structI.push_back(k++);
 
             spring_list[k] = Edge(n * i + j, n * (i + 1) + j);
-            rest_lengths[k] = rest_length;
-            stiffnesses[k] = stiffness;
+            materials[k] = Structural;
             structI.push_back(k++);
 
             // shearing springs
             spring_list[k] = Edge(n * i + j, n * (i + 1) + j + 1);
-            rest_lengths[k] = root2 * rest_length;
-            stiffnesses[k] = stiffness;
+            materials[k] = Shearing;
             shearI.push_back(k++);
 
             spring_list[k] = Edge(n * (i + 1) + j, n * i + j + 1);
-            rest_lengths[k] = root2 * rest_length;
-            stiffnesses[k] = stiffness;
+            materials[k] = Shearing;
             shearI.push_back(k++);
 
             // bending springs
             if (j % 2 == 0)
             {
                 spring_list[k] = Edge(n * i + j, n * i + j + 2);
-                rest_lengths[k] = 2 * rest_length;
-                stiffnesses[k] = stiffness;
+                materials[k] = Bending;
                 bendI.push_back(k++);
             }
             if (i % 2 == 0)
             {
                 spring_list[k] = Edge(n * i + j, n * (i + 2) + j);
-                rest_lengths[k] = 2 * rest_length;
-                stiffnesses[k] = stiffness;
+                materials[k] = Bending;
                 bendI.push_back(k++);
             }
         }
@@ -258,8 +417,9 @@ void MassSpringBuilder::uniformGrid(
     // compute external forces
     VectorXf fext = Vector3f(0, 0, -gravity).replicate(n_points, 1);
 
-    result = new mass_spring_system(n_points, n_springs, time_step, spring_list, rest_lengths,
-                                    stiffnesses, masses, fext, damping_factor);
+    result = new mass_spring_system(n_points, n_springs, time_step, spring_list, materials,
+                                    rest_lengths, stiffnesses, masses, fext, damping_factor);
+    result->grid_n = n;
 }
 MassSpringBuilder::IndexList MassSpringBuilder::getStructIndex() { return structI; }
 MassSpringBuilder::IndexList MassSpringBuilder::getShearIndex() { return shearI; }
@@ -328,17 +488,154 @@ void CgPointFixNode::fixPoint(unsigned int i)
     assert(i >= 0 && i < system->n_points);
     fix_map[3 * i] = Vector3f(vbuff[3 * i], vbuff[3 * i + 1], vbuff[3 * i + 2]);
 }
-void CgPointFixNode::releasePoint(unsigned int i) { fix_map.erase(3 * i); }
+void CgPointFixNode::releasePoint(unsigned int i)
+{
+    fix_map.erase(3 * i);
+    if (system->sleep)
+        system->sleep->wakePoint(i);
+}
+
+unsigned int CgPointFixNode::pinCount() const { return (unsigned int)fix_map.size(); }
+void CgPointFixNode::getPins(unsigned int *indices, float *positions) const
+{
+    unsigned int k = 0;
+    for (auto fix : fix_map)
+    {
+        indices[k] = fix.first / 3;
+        for (int j = 0; j < 3; j++)
+            positions[3 * k + j] = fix.second[j];
+        k++;
+    }
+}
+void CgPointFixNode::setPins(unsigned int n, const unsigned int *indices, const float *positions)
+{
+    fix_map.clear();
+    for (unsigned int k = 0; k < n; k++)
+    {
+        assert(indices[k] < system->n_points);
+        fix_map[3 * indices[k]] = Vector3f(positions[3 * k], positions[3 * k + 1], positions[3 * k + 2]);
+    }
+}
+
+// region fix node
+CgRegionFixNode::CgRegionFixNode(mass_spring_system *system, float *vbuff)
+    : CgPointNode(system, vbuff), offsets(system->n_points + 1, 0), center(-1), displacement(),
+      distances(system->n_points, std::numeric_limits<float>::max())
+{
+    // spring graph in CSR form, both directions
+    for (const mass_spring_system::Edge &spring : system->spring_list)
+    {
+        offsets[spring.first + 1]++;
+        offsets[spring.second + 1]++;
+    }
+    for (unsigned int i = 0; i < system->n_points; i++)
+        offsets[i + 1] += offsets[i];
+    neighbors.resize(offsets.back());
+    lengths.resize(offsets.back());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (unsigned int k = 0; k < system->n_springs; k++)
+    {
+        const mass_spring_system::Edge &spring = system->spring_list[k];
+        neighbors[fill[spring.first]] = spring.second;
+        lengths[fill[spring.first]++] = system->rest_lengths[system->materials[k]];
+        neighbors[fill[spring.second]] = spring.first;
+        lengths[fill[spring.second]++] = system->rest_lengths[system->materials[k]];
+    }
+}
+
+bool CgRegionFixNode::query(unsigned int i) const { return center == (int)i; }
+
+void CgRegionFixNode::satisfy()
+{
+    const unsigned int n = (unsigned int)region.size();
+    const float dx = displacement[0], dy = displacement[1], dz = displacement[2];
+    for (unsigned int k = 0; k < n; k++)
+    {
+        if (system->sleep)
+            system->sleep->wakePoint(region[k]); // grabbed regions stay awake
+        float *x = vbuff + 3 * region[k];
+        const float *a = anchors.data() + 3 * k;
+        const float w = weights[k];
+        x[0] += w * (a[0] + dx - x[0]);
+        x[1] += w * (a[1] + dy - x[1]);
+        x[2] += w * (a[2] + dz - x[2]);
+    }
+}
+
+void CgRegionFixNode::grab(unsigned int i, float radius)
+{
+    assert(i < system->n_points);
+    release();
+    center = (int)i;
+
+    // bounded dijkstra from the center
+    typedef std::pair<float, unsigned int> Item;
+    auto farther = [](const Item &a, const Item &b) { return a.first > b.first; };
+    distances[i] = 0.0f;
+    heap.push_back(Item(0.0f, i));
+    while (!heap.empty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), farther);
+        Item item = heap.back();
+        heap.pop_back();
+        unsigned int p = item.second;
+        if (item.first > distances[p])
+            continue; // stale entry
+
+        float t = radius > 0.0f ? item.first / radius : 0.0f;
+        region.push_back(p);
+        weights.push_back((1.0f - t * t) * (1.0f - t * t));
+        anchors.insert(anchors.end(), vbuff + 3 * p, vbuff + 3 * p + 3);
+
+        for (unsigned int k = offsets[p]; k < offsets[p + 1]; k++)
+        {
+            unsigned int q = neighbors[k];
+            float d = item.first + lengths[k];
+            if (d < radius && d < distances[q])
+            {
+                distances[q] = d;
+                heap.push_back(Item(d, q));
+                std::push_heap(heap.begin(), heap.end(), farther);
+            }
+        }
+    }
+
+    // reset the visited distances only
+    for (unsigned int p : region)
+        distances[p] = std::numeric_limits<float>::max();
+}
+
+void CgRegionFixNode::move(const float *v)
+{
+    for (int j = 0; j < 3; j++)
+        displacement[j] += v[j];
+}
+
+void CgRegionFixNode::release()
+{
+    center = -1;
+    region.clear();
+    weights.clear();
+    anchors.clear();
+    displacement[0] = displacement[1] = displacement[2] = 0.0f;
+}
+
+unsigned int CgRegionFixNode::regionSize() const { return (unsigned int)region.size(); }
 
 // spring deformation node
 CgSpringDeformationNode::CgSpringDeformationNode(mass_spring_system *system, float *vbuff,
                                                  float tauc, unsigned int n_iter) : CgSpringNode(system, vbuff), tauc(tauc), n_iter(n_iter) {}
 void CgSpringDeformationNode::satisfy()
 {
+    // springs between sleeping points are skipped, sleeping ends are fixed
+    const unsigned char *awake_points = system->sleep ? system->sleep->pointMask() : nullptr;
+    const unsigned char *awake_springs = system->sleep ? system->sleep->springMask() : nullptr;
     for (int k = 0; k < n_iter; k++)
     {
         for (unsigned int i : items)
         {
+            if (awake_springs && !awake_springs[i])
+                continue;
             Edge spring = system->spring_list[i];
             CgQueryFixedPointVisitor visitor;
 
@@ -348,7 +645,7 @@ void CgSpringDeformationNode::satisfy()
                 vbuff[3 * spring.first + 2] - vbuff[3 * spring.second + 2]);
 
             float len = p12.norm();
-            float rlen = system->rest_lengths[i];
+            float rlen = system->rest_lengths[system->materials[i]];
             float diff = (len - (1 + tauc) * rlen) / len;
             float rate = (len - rlen) / rlen;
 
@@ -361,14 +658,14 @@ void CgSpringDeformationNode::satisfy()
             f1 = f2 = 0.5f;
 
             // if first point is fixed
-            if (visitor.queryPoint(*this, spring.first))
+            if ((awake_points && !awake_points[spring.first]) || visitor.queryPoint(*this, spring.first))
             {
                 f1 = 0.0f;
                 f2 = 1.0f;
             }
 
             // if second point is fixed
-            if (visitor.queryPoint(*this, spring.second))
+            if ((awake_points && !awake_points[spring.second]) || visitor.queryPoint(*this, spring.second))
             {
                 f1 = (f1 != 0.0f ? 1.0f : 0.0f);
                 f2 = 0.0f;
@@ -405,6 +702,7 @@ bool CgSphereCollisionNode::query(unsigned int i) const
 
 void CgSphereCollisionNode::satisfy()
 {
+    const unsigned char *awake = system->sleep ? system->sleep->pointMask() : nullptr;
     for (int i = 0; i < system->n_points; i++)
     {
         Vector3f p(
@@ -412,6 +710,14 @@ void CgSphereCollisionNode::satisfy()
             vbuff[3 * i + 1] - center[1],
             vbuff[3 * i + 2] - center[2]);
 
+        // sleeping points rest on the surface, only a collider moving into them wakes them
+        if (awake && !awake[i])
+        {
+            if (p.norm() >= radius * 0.999f)
+                continue;
+            system->sleep->wakePoint(i);
+        }
+
         if (p.norm() < radius)
         {
             p.normalize();
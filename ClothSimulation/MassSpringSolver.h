@@ -1,36 +1,51 @@
 #pragma once
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "GridOperators.h"
+#include "LinearSolver.h"
+
+class RegionSleep;
+
 // Mass-Spring System struct
+//
+// Springs share their parameters through material classes: spring k has rest
+// length rest_lengths[materials[k]] and stiffness stiffnesses[materials[k]],
+// at most 256 classes.
 struct mass_spring_system
 {
     typedef Eigen::SparseMatrix<float> SparseMatrix;
     typedef Eigen::VectorXf VectorXf;
     typedef std::pair<unsigned int, unsigned int> Edge;
     typedef std::vector<Edge> EdgeList;
+    typedef std::vector<uint8_t> MaterialList;
 
     // parameters
     unsigned int n_points;  // number of points
     unsigned int n_springs; // number of springs
     float time_step;        // time step
     EdgeList spring_list;   // spring edge list
-    VectorXf rest_lengths;  // spring rest lengths
-    VectorXf stiffnesses;   // spring stiffnesses
+    MaterialList materials; // spring material classes
+    VectorXf rest_lengths;  // rest length per material class
+    VectorXf stiffnesses;   // stiffness per material class
     VectorXf masses;        // points masses
     VectorXf fext;          // external forces
     float damping_factor;   // damping factor
+    unsigned int grid_n;    // grid width if built by MassSpringBuilder::uniformGrid, else 0
+    RegionSleep *sleep;     // sleeping regions, set by MassSpringSolver::enableSleeping, else nullptr
 
     mass_spring_system(
         unsigned int n_points,  // number of points
         unsigned int n_springs, // number of springs
         float time_step,        // time step
         EdgeList spring_list,   // spring edge list
-        VectorXf rest_lengths,  // spring rest lengths
-        VectorXf stiffnesses,   // spring stiffnesses
+        MaterialList materials, // spring material classes
+        VectorXf rest_lengths,  // rest length per material class
+        VectorXf stiffnesses,   // stiffness per material class
         VectorXf masses,        // points masses
         VectorXf fext,          // external forces
         float damping_factor    // damping factor
@@ -44,37 +59,68 @@ private:
     typedef Eigen::Vector3f Vector3f;
     typedef Eigen::VectorXf VectorXf;
     typedef Eigen::SparseMatrix<float> SparseMatrix;
-    typedef Eigen::SimplicialLLT<Eigen::SparseMatrix<float>> Cholesky;
     typedef Eigen::Map<Eigen::VectorXf> Map;
     typedef std::pair<unsigned int, unsigned int> Edge;
-    typedef Eigen::Triplet<float> Triplet;
-    typedef std::vector<Triplet> TripletList;
 
     // system
     mass_spring_system *system;
-    Cholesky system_matrix;
+    LinearSolver *system_matrix; // factored M + h^2 L, scalar
+
+    // springs
+    GridOperators *grid;        // matrix-free spring step for grid systems, else nullptr
 
-    // M, L, J matrices
-    SparseMatrix M;
-    SparseMatrix L;
-    SparseMatrix J;
+    // springs by color, no two springs of a color share a point; color c is
+    // colored_springs[color_offsets[c] .. color_offsets[c + 1]), empty for grids
+    std::vector<unsigned int> color_offsets;
+    std::vector<unsigned int> colored_springs;
 
     // state
     Map current_state;          // q(n), current state
     VectorXf prev_state;        // q(n - 1), previous state
-    VectorXf spring_directions; // d, spring directions
     VectorXf inertial_term;     // M * y, y = (a + 1) * q(n) - a * q(n - 1)
+    VectorXf scaled_fext;       // h^2 * fext
+    VectorXf rhs;               // right hand side of the global step
+    VectorXf sleeping_forces;   // h^2 * J * d of the sleeping springs, fixed while they sleep
+    unsigned long sleeping_version; // RegionSleep::springVersion of sleeping_forces
+    VectorXf iterate_state;     // state before the last iteration, for adaptive solves
+
+    // statistics
+    unsigned long n_steps;      // time steps solved
+    unsigned long n_iterations; // iterations over all time steps
+
+    RegionSleep *sleep;         // owned, nullptr unless sleeping is enabled
 
     // steps
-    void globalStep();
-    void localStep();
+    void beginStep();
+    void localStep();  // project awake springs and accumulate the right hand side, d is not stored
+    void globalStep(); // solve for the state
 
 public:
-    MassSpringSolver(mass_spring_system *system, float *vbuff);
+    MassSpringSolver(mass_spring_system *system, float *vbuff,
+                     LinearSolver::Type solver_type = LinearSolver::Cholesky);
+    MassSpringSolver(const MassSpringSolver &other) = delete;
+    MassSpringSolver &operator=(const MassSpringSolver &other) = delete;
+    ~MassSpringSolver();
 
     // solve iterations
     void solve(unsigned int n);
     void timedSolve(unsigned int ms);
+
+    // solve with between min_iter and max_iter iterations, stopping once the RMS change of
+    // an iteration is below tol * RMS displacement of the time step + abs_tol
+    unsigned int solveAdaptive(unsigned int min_iter, unsigned int max_iter, float tol, float abs_tol);
+    float averageIterations() const; // iterations per time step so far
+
+    // let regions at rest fall asleep, see RegionSleep; sleeping points are held
+    // in place through the global step and time steps with every region asleep
+    // are skipped
+    void enableSleeping(float sleep_speed, unsigned int quiet_steps);
+    RegionSleep *getSleep(); // nullptr unless enabled
+
+    // state access
+    mass_spring_system *getSystem();
+    float *currentState();     // q(n), 3 * n_points floats
+    float *previousState();    // q(n - 1), 3 * n_points floats
 };
 
 // Mass-Spring System Builder class
@@ -93,6 +139,14 @@ private:
     mass_spring_system *result;
 
 public:
+    // material classes of uniformGrid springs
+    enum Material
+    {
+        Structural,
+        Shearing,
+        Bending
+    };
+
     void uniformGrid(
         unsigned int n,       // grid width
         float time_step,      // time step
@@ -124,6 +178,7 @@ protected:
 
 public:
     CgNode(mass_spring_system *system, float *vbuff);
+    virtual ~CgNode() {}
 
     virtual void satisfy() = 0;                      // satisfy constraint
     virtual bool accept(CgNodeVisitor &visitor) = 0; // accept visitor
@@ -177,6 +232,48 @@ public:
     virtual bool query(unsigned int i) const;
     virtual void fixPoint(unsigned int i);     // add point at index i to list
     virtual void releasePoint(unsigned int i); // remove point at index i from list
+
+    // pin set access
+    unsigned int pinCount() const;
+    void getPins(unsigned int *indices, float *positions) const;  // fill 1 index and 3 floats per pin
+    void setPins(unsigned int n, const unsigned int *indices, const float *positions);
+};
+
+// region fix node
+//
+// Grabs every point within a graph distance radius of a center point. Graph
+// distances run along springs at rest length and are computed once per grab,
+// moving the region only updates a shared displacement. Each satisfy pulls a
+// grabbed point towards its grab position plus the displacement by its weight
+// (1 - (d / radius)^2)^2, so the center is pinned and the falloff is smooth.
+class CgRegionFixNode : public CgPointNode
+{
+protected:
+    // spring graph, neighbors of point i: neighbors[offsets[i] .. offsets[i + 1])
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> neighbors;
+    std::vector<float> lengths;
+
+    // grabbed region
+    int center;                        // grabbed center point, -1 if none
+    std::vector<unsigned int> region;  // grabbed points
+    std::vector<float> weights;        // falloff weight per grabbed point
+    std::vector<float> anchors;        // grab positions, 3 floats per grabbed point
+    float displacement[3];
+
+    // search state, reused between grabs
+    std::vector<float> distances;      // graph distance per point, max if unvisited
+    std::vector<std::pair<float, unsigned int>> heap;
+
+public:
+    CgRegionFixNode(mass_spring_system *system, float *vbuff);
+    virtual void satisfy();
+    virtual bool query(unsigned int i) const; // only the center point is fixed
+
+    void grab(unsigned int i, float radius); // grab points within radius of point i
+    void move(const float *v);               // move the grabbed region by v
+    void release();
+    unsigned int regionSize() const;
 };
 
 // spring deformation node
@@ -1,53 +1,61 @@
 #include "Mesh.h"
+#include <cassert>
+#include <utility>
 
 // MESH
-float *Mesh::vbuff() { return VERTEX_DATA(this); }
-float *Mesh::nbuff() { return NORMAL_DATA(this); }
-float *Mesh::tbuff() { return TEXTURE_DATA(this); }
-unsigned int *Mesh::ibuff() { return &_ibuff[0]; }
-void Mesh::useIBuff(std::vector<unsigned int> &_ibuff) { this->_ibuff = _ibuff; }
+Mesh::Mesh(std::vector<float> positions, std::vector<float> texcoords, std::vector<unsigned int> indices)
+    : _vbuff(std::move(positions)), _nbuff(_vbuff.size()), _tbuff(std::move(texcoords)),
+      _ibuff(std::move(indices))
+{
+    assert(_vbuff.size() % 3 == 0 && _tbuff.size() / 2 == _vbuff.size() / 3);
+    normals = new NormalKernel(_ibuff.data(), ibuffLen(), n_vertices());
+    updateNormals();
+}
+
+Mesh::~Mesh() { delete normals; }
 
-unsigned int Mesh::vbuffLen() { return (unsigned int)n_vertices() * 3; }
-unsigned int Mesh::nbuffLen() { return (unsigned int)n_vertices() * 3; }
-unsigned int Mesh::tbuffLen() { return (unsigned int)n_vertices() * 2; }
+float *Mesh::vbuff() { return _vbuff.data(); }
+float *Mesh::nbuff() { return _nbuff.data(); }
+float *Mesh::tbuff() { return _tbuff.data(); }
+unsigned int *Mesh::ibuff() { return _ibuff.data(); }
+
+unsigned int Mesh::vbuffLen() { return (unsigned int)_vbuff.size(); }
+unsigned int Mesh::nbuffLen() { return (unsigned int)_nbuff.size(); }
+unsigned int Mesh::tbuffLen() { return (unsigned int)_tbuff.size(); }
 unsigned int Mesh::ibuffLen() { return (unsigned int)_ibuff.size(); }
 
+unsigned int Mesh::n_vertices() { return (unsigned int)_vbuff.size() / 3; }
+unsigned int Mesh::n_faces() { return (unsigned int)_ibuff.size() / 3; }
+
+void Mesh::updateNormals() { normals->compute(vbuff(), nbuff()); }
+
 // MESH BUILDER
 void MeshBuilder::uniformGrid(float w, int n)
 {
-    result = new Mesh;
-    unsigned int ibuffLen = 6 * (n - 1) * (n - 1);
-    std::vector<unsigned int> ibuff(ibuffLen);
-
-    // request mesh properties
-    result->request_vertex_normals();
-    result->request_vertex_normals();
-    result->request_vertex_texcoords2D();
+    std::vector<float> vbuff(3 * n * n);
+    std::vector<float> tbuff(2 * n * n);
+    std::vector<unsigned int> ibuff(6 * (n - 1) * (n - 1));
 
     // generate mesh
-    unsigned int idx = 0;                                                 // vertex index
-    const float d = w / (n - 1);                                          // step distance
-    const float ud = 1.0f / (n - 1);                                      // unit step distance
-    const OpenMesh::Vec3f o = OpenMesh::Vec3f(-w / 2.0f, w / 2.0f, 0.0f); // origin
-    const OpenMesh::Vec3f ux = OpenMesh::Vec3f(1.0f, 0.0f, 0.0f);         // unit x direction
-    const OpenMesh::Vec3f uy = OpenMesh::Vec3f(0.0f, -1.0f, 0.0f);        // unit y direction
-    std::vector<OpenMesh::VertexHandle> handle_table(n * n);              // tan;e storing vertex handles for easy grid connectivity establishment
+    unsigned int idx = 0;            // index counter
+    const float d = w / (n - 1);     // step distance
+    const float ud = 1.0f / (n - 1); // unit step distance
+    const float o[3] = {-w / 2.0f, w / 2.0f, 0.0f}; // origin, x runs along +x and y along -y
 
     for (int i = 0; i < n; i++)
     {
         for (int j = 0; j < n; j++)
         {
-            handle_table[j + i * n] = result->add_vertex(o + d * j * ux + d * i * uy);        // add vertex
-            result->set_texcoord2D(handle_table[j + i * n], OpenMesh::Vec2f(ud * j, ud * i)); // add texture coordinates
+            // add vertex and texture coordinates
+            vbuff[3 * (j + i * n) + 0] = o[0] + d * j;
+            vbuff[3 * (j + i * n) + 1] = o[1] - d * i;
+            vbuff[3 * (j + i * n) + 2] = o[2];
+            tbuff[2 * (j + i * n) + 0] = ud * j;
+            tbuff[2 * (j + i * n) + 1] = ud * i;
 
             // add connectivity
             if (i > 0 && j < n - 1)
             {
-                result->add_face(
-                    handle_table[j + i * n],
-                    handle_table[j + 1 + (i - 1) * n],
-                    handle_table[j + (i - 1) * n]);
-
                 ibuff[idx++] = j + i * n;
                 ibuff[idx++] = j + 1 + (i - 1) * n;
                 ibuff[idx++] = j + (i - 1) * n;
@@ -55,11 +63,6 @@ void MeshBuilder::uniformGrid(float w, int n)
 
             if (j > 0 && i > 0)
             {
-                result->add_face(
-                    handle_table[j + i * n],
-                    handle_table[j + (i - 1) * n],
-                    handle_table[j - 1 + i * n]);
-
                 ibuff[idx++] = j + i * n;
                 ibuff[idx++] = j + (i - 1) * n;
                 ibuff[idx++] = j - 1 + i * n;
@@ -67,13 +70,8 @@ void MeshBuilder::uniformGrid(float w, int n)
         }
     }
 
-    // calculate normals
-    result->request_face_normals();
-    result->update_normals();
-    result->release_face_normals();
-
-    // set index buffer
-    result->useIBuff(ibuff);
+    // normals are computed by the mesh
+    result = new Mesh(std::move(vbuff), std::move(tbuff), std::move(ibuff));
 }
 
-Mesh *MeshBuilder::getResult() { return result; }
\ No newline at end of file
+Mesh *MeshBuilder::getResult() { return result; }
@@ -1,22 +1,28 @@
 #pragma once
-#include <OpenMesh/Core/Mesh/TriMesh_ArrayKernelT.hh>
 #include <vector>
 
-// Mesh Type
-typedef OpenMesh::TriMesh_ArrayKernelT<> _Mesh;
-
-// Macros for extracting buffers from OpenMesh
-#define VERTEX_DATA(mesh) (float *)&(mesh->point(*mesh->vertices_begin()))
-#define NORMAL_DATA(mesh) (float *)&(mesh->normal(*mesh->vertices_begin()))
-#define TEXTURE_DATA(mesh) (float *)&(mesh->texcoord2D(*mesh->vertices_begin()))
+#include "Normals.h"
 
 // Mesh class
-class Mesh : public _Mesh
+//
+// Runtime triangle mesh in flat buffers: 3 floats per position and normal,
+// 2 per texture coordinate, 3 indices per face. Normals are updated from the
+// positions with a precomputed vertex to face adjacency.
+class Mesh
 {
 private:
+    std::vector<float> _vbuff;
+    std::vector<float> _nbuff;
+    std::vector<float> _tbuff;
     std::vector<unsigned int> _ibuff;
+    NormalKernel *normals; // vertex to face adjacency
 
 public:
+    Mesh(std::vector<float> positions, std::vector<float> texcoords, std::vector<unsigned int> indices);
+    Mesh(const Mesh &other) = delete;
+    Mesh &operator=(const Mesh &other) = delete;
+    ~Mesh();
+
     // pointers to buffers
     float *vbuff();
     float *nbuff();
@@ -29,8 +35,11 @@ public:
     unsigned int tbuffLen();
     unsigned int ibuffLen();
 
-    // set index buffer
-    void useIBuff(std::vector<unsigned int> &_ibuff);
+    unsigned int n_vertices();
+    unsigned int n_faces();
+
+    // recompute vertex normals from positions
+    void updateNormals();
 };
 
 class MeshBuilder
@@ -41,4 +50,4 @@ private:
 public:
     void uniformGrid(float w, int n);
     Mesh *getResult();
-};
\ No newline at end of file
+};
@@ -0,0 +1,42 @@
+#include "MeshImport.h"
+#include <OpenMesh/Core/IO/MeshIO.hh>
+#include <OpenMesh/Core/Mesh/TriMesh_ArrayKernelT.hh>
+#include <stdexcept>
+#include <string>
+
+typedef OpenMesh::TriMesh_ArrayKernelT<> _Mesh;
+
+Mesh *MeshImporter::read(const char *path)
+{
+    _Mesh mesh;
+    mesh.request_vertex_texcoords2D();
+    OpenMesh::IO::Options options = OpenMesh::IO::Options::VertexTexCoord;
+    if (!OpenMesh::IO::read_mesh(mesh, path, options))
+        throw std::runtime_error(std::string("Failed to read mesh ") + path);
+    bool has_texcoords = options.check(OpenMesh::IO::Options::VertexTexCoord);
+
+    // flatten
+    std::vector<float> vbuff(3 * mesh.n_vertices());
+    std::vector<float> tbuff(2 * mesh.n_vertices(), 0.0f);
+    std::vector<unsigned int> ibuff;
+    ibuff.reserve(3 * mesh.n_faces());
+    for (auto vh : mesh.vertices())
+    {
+        const _Mesh::Point &p = mesh.point(vh);
+        for (int j = 0; j < 3; j++)
+            vbuff[3 * vh.idx() + j] = p[j];
+        if (has_texcoords)
+        {
+            const _Mesh::TexCoord2D &t = mesh.texcoord2D(vh);
+            tbuff[2 * vh.idx() + 0] = t[0];
+            tbuff[2 * vh.idx() + 1] = t[1];
+        }
+    }
+    for (auto fh : mesh.faces())
+    {
+        for (auto vh : mesh.fv_range(fh))
+            ibuff.push_back(vh.idx());
+    }
+
+    return new Mesh(std::move(vbuff), std::move(tbuff), std::move(ibuff));
+}
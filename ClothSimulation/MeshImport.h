@@ -0,0 +1,12 @@
+#pragma once
+#include "Mesh.h"
+
+// Mesh importer, the only user of OpenMesh
+//
+// Reads any format OpenMesh supports, triangulates it and copies positions,
+// texture coordinates (zero if the file has none) and faces into a flat Mesh.
+class MeshImporter
+{
+public:
+    static Mesh *read(const char *path); // throws std::runtime_error if the file can't be read
+};
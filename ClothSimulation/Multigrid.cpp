@@ -0,0 +1,183 @@
+#include "Multigrid.h"
+#include "Parallel.h"
+#include <cmath>
+#include <stdexcept>
+
+// y = A x, or y += A x with accumulate, on vectors with 3 floats per point
+template <class Matrix>
+static void multiply(const Matrix &A, const float *x, float *y, bool accumulate)
+{
+    const int rows = A.rows();
+    const int *outer = A.outerIndexPtr();
+    const int *inner = A.innerIndexPtr();
+    const float *values = A.valuePtr();
+    parallelFor(0, rows, [&](int i)
+    {
+        float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f;
+        for (int k = outer[i]; k < outer[i + 1]; k++)
+        {
+            const float *xj = x + 3 * inner[k];
+            s0 += values[k] * xj[0];
+            s1 += values[k] * xj[1];
+            s2 += values[k] * xj[2];
+        }
+        float *yi = y + 3 * i;
+        if (accumulate)
+        {
+            yi[0] += s0;
+            yi[1] += s1;
+            yi[2] += s2;
+        }
+        else
+        {
+            yi[0] = s0;
+            yi[1] = s1;
+            yi[2] = s2;
+        }
+    });
+}
+
+MultigridSolver::MultigridSolver(unsigned int grid_n)
+    : grid_n(grid_n), tolerance(1e-4f), max_cycles(20), pre_sweeps(2), post_sweeps(2)
+{
+}
+
+void MultigridSolver::factor(const SparseMatrix &A)
+{
+    if ((unsigned int)A.rows() != grid_n * grid_n)
+        throw std::runtime_error("Multigrid system matrix doesn't match the grid");
+
+    levels.clear();
+    levels.reserve(16);
+    RowMatrix operator_ = A;
+    unsigned int n = grid_n;
+    while (true)
+    {
+        levels.emplace_back();
+        Level &level = levels.back();
+        level.n = n;
+        level.A.swap(operator_);
+        level.x.resize(3 * n * n);
+        level.b.resize(3 * n * n);
+        level.r.resize(3 * n * n);
+        level.inv_diagonal.resize(n * n);
+        for (int i = 0; i < level.A.outerSize(); i++)
+        {
+            float sum = 0.0f;
+            for (RowMatrix::InnerIterator it(level.A, i); it; ++it)
+                sum += std::abs(it.value());
+            level.inv_diagonal[i] = 1.0f / sum;
+        }
+
+        // coarsest level
+        if (n <= coarsest_n || n % 2 == 0)
+        {
+            coarse_solver.factor(SparseMatrix(level.A));
+            break;
+        }
+
+        // bilinear interpolation, coarse node (I, J) is fine node (2I, 2J)
+        const unsigned int nc = (n + 1) / 2;
+        Eigen::VectorXi row_sizes(n * n);
+        for (unsigned int i = 0; i < n; i++)
+        {
+            for (unsigned int j = 0; j < n; j++)
+                row_sizes[n * i + j] = (1 + i % 2) * (1 + j % 2);
+        }
+        level.P.resize(n * n, nc * nc);
+        level.P.reserve(row_sizes);
+        for (unsigned int i = 0; i < n; i++)
+        {
+            for (unsigned int j = 0; j < n; j++)
+            {
+                const float w = 1.0f / row_sizes[n * i + j];
+                for (unsigned int ci = i / 2; ci <= (i + 1) / 2; ci++)
+                {
+                    for (unsigned int cj = j / 2; cj <= (j + 1) / 2; cj++)
+                        level.P.insert(n * i + j, nc * ci + cj) = w;
+                }
+            }
+        }
+        level.P.makeCompressed();
+        level.R = level.P.transpose();
+
+        // galerkin coarse operator
+        operator_ = RowMatrix(level.R * level.A) * level.P;
+        n = nc;
+    }
+    saved.resize(3 * grid_n * grid_n);
+}
+
+void MultigridSolver::residual(Level &level)
+{
+    multiply(level.A, level.x.data(), level.r.data(), false);
+    level.r = level.b - level.r;
+}
+
+void MultigridSolver::smooth(Level &level, unsigned int sweeps)
+{
+    const int n_points = level.n * level.n;
+    for (unsigned int s = 0; s < sweeps; s++)
+    {
+        residual(level);
+        float *x = level.x.data();
+        const float *r = level.r.data();
+        const float *d = level.inv_diagonal.data();
+        parallelFor(0, n_points, [&](int i)
+        {
+            x[3 * i] += d[i] * r[3 * i];
+            x[3 * i + 1] += d[i] * r[3 * i + 1];
+            x[3 * i + 2] += d[i] * r[3 * i + 2];
+        });
+    }
+}
+
+void MultigridSolver::cycle(unsigned int l)
+{
+    Level &level = levels[l];
+    if (l + 1 == levels.size())
+    {
+        coarse_solver.solve(level.b.data(), level.x.data());
+        return;
+    }
+
+    Level &coarse = levels[l + 1];
+    smooth(level, pre_sweeps);
+    residual(level);
+    multiply(level.R, level.r.data(), coarse.b.data(), false);
+    coarse.x.setZero();
+    cycle(l + 1);
+    multiply(level.P, coarse.x.data(), level.x.data(), true);
+    smooth(level, post_sweeps);
+}
+
+void MultigridSolver::solve(const float *b, float *x)
+{
+    Level &level = levels[0];
+    const unsigned int size = 3 * level.n * level.n;
+    level.b = Eigen::Map<const Eigen::VectorXf>(b, size);
+    level.x = Eigen::Map<const Eigen::VectorXf>(x, size); // warm start
+    const float threshold = tolerance * level.b.norm();
+
+    residual(level);
+    float norm = level.r.norm();
+    unsigned int i = 0;
+    while (i < max_cycles && norm > threshold)
+    {
+        saved = level.x;
+        cycle(0);
+        residual(level);
+        i++;
+
+        // a cycle that doesn't halve the residual has hit float round-off, which
+        // happens before the tolerance for fine grids with tiny point masses;
+        // one that made the residual larger is undone
+        float next = level.r.norm();
+        if (next >= norm)
+            level.x = saved;
+        if (next > 0.5f * norm)
+            break;
+        norm = next;
+    }
+    Eigen::Map<Eigen::VectorXf>(x, size) = level.x;
+}
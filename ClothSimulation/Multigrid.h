@@ -0,0 +1,55 @@
+#pragma once
+#include <Eigen/Sparse>
+#include <vector>
+
+#include "LinearSolver.h"
+
+// Geometric multigrid for the global step of grid systems
+//
+// Level 0 is the n x n cloth grid in row-major order. Each coarser level keeps
+// every other row and column, n -> (n + 1) / 2, as long as n is odd and above
+// coarsest_n; n = 2^k + 1 gives the full hierarchy. Interpolation is bilinear
+// and coarse operators are Galerkin products P^T A P, so bending springs are
+// represented on every level without rebuilding springs. The V-cycles smooth
+// with l1-Jacobi sweeps, parallel over points, and solve the coarsest level
+// with a sparse Cholesky. A solve starts from the previous solution and runs
+// cycles until the residual is below tolerance * |b| or stops decreasing,
+// and keeps the iterate with the smaller residual.
+// Every level stores a constant number of values per point, so memory is
+// linear in the points.
+class MultigridSolver : public LinearSolver
+{
+private:
+    typedef Eigen::SparseMatrix<float, Eigen::RowMajor> RowMatrix;
+
+    struct Level
+    {
+        unsigned int n;               // grid width
+        RowMatrix A;                  // operator
+        RowMatrix P;                  // interpolation from the next coarser level
+        RowMatrix R;                  // restriction to the next coarser level, P^T
+        Eigen::VectorXf inv_diagonal; // smoother scaling, 1 / sum_j |A(i, j)|
+        Eigen::VectorXf x, b, r;      // solution, right hand side, residual; 3 floats per point
+    };
+
+    std::vector<Level> levels;
+    CholeskySolver coarse_solver;
+    Eigen::VectorXf saved;            // level 0 solution before the last cycle
+
+    unsigned int grid_n;
+    float tolerance;
+    unsigned int max_cycles;
+    unsigned int pre_sweeps, post_sweeps;
+
+    void residual(Level &level);                     // r = b - A x
+    void smooth(Level &level, unsigned int sweeps);  // x += D^-1 (b - A x)
+    void cycle(unsigned int l);                      // V-cycle from levels[l].x
+
+public:
+    static const unsigned int coarsest_n = 33;
+
+    MultigridSolver(unsigned int grid_n);
+
+    virtual void factor(const SparseMatrix &A);
+    virtual void solve(const float *b, float *x);
+};
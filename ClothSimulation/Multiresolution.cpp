@@ -0,0 +1,115 @@
+#include "Multiresolution.h"
+#include "Parallel.h"
+#include <cassert>
+#include <cmath>
+
+GridUpsampler::GridUpsampler(unsigned int n, float rest_length)
+    : n(n), nc((n + 1) / 2), rest_length(rest_length), scratch(3 * n * n)
+{
+    assert(n % 2 == 1 && n >= 3);
+}
+
+void GridUpsampler::downsample(const float *fine, float *coarse) const
+{
+    for (unsigned int i = 0; i < nc; i++)
+    {
+        for (unsigned int j = 0; j < nc; j++)
+        {
+            const float *p = fine + 3 * (n * 2 * i + 2 * j);
+            float *c = coarse + 3 * (nc * i + j);
+            c[0] = p[0];
+            c[1] = p[1];
+            c[2] = p[2];
+        }
+    }
+}
+
+// point between points t and t + 1 of the count points at base + k * stride
+static inline void refine(const float *base, int stride, int t, int count, float *out)
+{
+    const float *p1 = base + t * stride, *p2 = p1 + stride;
+    if (t >= 1 && t + 2 < count)
+    {
+        const float *p0 = p1 - stride, *p3 = p2 + stride;
+        for (int c = 0; c < 3; c++)
+            out[c] = 0.5625f * (p1[c] + p2[c]) - 0.0625f * (p0[c] + p3[c]);
+    }
+    else
+    {
+        for (int c = 0; c < 3; c++)
+            out[c] = 0.5f * (p1[c] + p2[c]);
+    }
+}
+
+void GridUpsampler::upsample(const float *coarse, float *fine) const
+{
+    const int n = this->n, nc = this->nc;
+
+    // even rows from the coarse rows
+    parallelFor(0, (n + 1) / 2, [&](int k)
+    {
+        const int i = 2 * k;
+        const float *row = coarse + 3 * nc * (i / 2);
+        float *out = fine + 3 * n * i;
+        for (int j = 0; j < n; j++)
+        {
+            if (j % 2 == 0)
+            {
+                out[3 * j] = row[3 * (j / 2)];
+                out[3 * j + 1] = row[3 * (j / 2) + 1];
+                out[3 * j + 2] = row[3 * (j / 2) + 2];
+            }
+            else
+                refine(row, 3, j / 2, nc, out + 3 * j);
+        }
+    });
+
+    // odd rows from the even rows, column by column
+    parallelFor(0, n / 2, [&](int k)
+    {
+        const int i = 2 * k + 1;
+        for (int j = 0; j < n; j++)
+            refine(fine + 3 * j, 6 * n, i / 2, nc, fine + 3 * (n * i + j));
+    });
+}
+
+void GridUpsampler::relax(float *fine, unsigned int iterations)
+{
+    const int n = this->n;
+    for (unsigned int it = 0; it < iterations; it++)
+    {
+        scratch.assign(fine, fine + 3 * n * n);
+        const float *q = scratch.data();
+        parallelFor(0, n, [&](int i)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                // coarse nodes are simulated
+                if (i % 2 == 0 && j % 2 == 0)
+                    continue;
+
+                // average of the positions each structural spring wants for the node
+                const unsigned int p = n * i + j;
+                const int neighbors[4][2] = {{i - 1, j}, {i + 1, j}, {i, j - 1}, {i, j + 1}};
+                float sum[3] = {0.0f, 0.0f, 0.0f};
+                unsigned int count = 0;
+                for (const int *nb : neighbors)
+                {
+                    if (nb[0] < 0 || nb[0] >= n || nb[1] < 0 || nb[1] >= n)
+                        continue;
+                    const float *a = q + 3 * p, *b = q + 3 * (n * nb[0] + nb[1]);
+                    float d[3] = {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+                    float length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+                    float s = length > 0.0f ? rest_length / length : 1.0f;
+                    sum[0] += b[0] + s * d[0];
+                    sum[1] += b[1] + s * d[1];
+                    sum[2] += b[2] + s * d[2];
+                    count++;
+                }
+                fine[3 * p] = sum[0] / count;
+                fine[3 * p + 1] = sum[1] / count;
+                fine[3 * p + 2] = sum[2] / count;
+            }
+        });
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+
+// Detail reconstruction of an n x n cloth grid from its (n + 1) / 2 grid
+//
+// In two-level mode the coarse grid is simulated and fine node (2I, 2J) is
+// coarse node (I, J). upsample() fills in the other fine nodes with the
+// interpolatory four-point scheme along rows and then columns: a new node
+// between p1 and p2 is 9/16 (p1 + p2) - 1/16 (p0 + p3), the midpoint next to
+// the border. relax() runs Jacobi sweeps over the fine structural springs that
+// move only the new nodes towards rest length, taking out the stretch that
+// interpolation leaves in folds. Both run in parallel over rows.
+class GridUpsampler
+{
+private:
+    unsigned int n;             // fine grid width
+    unsigned int nc;            // coarse grid width, (n + 1) / 2
+    float rest_length;          // fine structural spring rest length
+    std::vector<float> scratch; // positions before a relaxation sweep
+
+public:
+    GridUpsampler(unsigned int n, float rest_length);
+
+    void downsample(const float *fine, float *coarse) const; // coarse nodes of a fine grid
+    void upsample(const float *coarse, float *fine) const;   // 3 floats per point
+    void relax(float *fine, unsigned int iterations);
+};
@@ -0,0 +1,82 @@
+#include "Normals.h"
+#include <cassert>
+#include <cmath>
+
+NormalKernel::NormalKernel(const unsigned int *ibuff, unsigned int ibuffLen, unsigned int n_vertices)
+    : n_vertices(n_vertices), n_faces(ibuffLen / 3), indices(ibuff),
+      face_offsets(n_vertices + 1, 0), vertex_faces(ibuffLen), face_normals(ibuffLen)
+{
+    assert(ibuffLen % 3 == 0);
+
+    // count faces per vertex, prefix sum into offsets, then fill
+    for (unsigned int i = 0; i < ibuffLen; i++)
+    {
+        assert(indices[i] < n_vertices);
+        face_offsets[indices[i] + 1]++;
+    }
+    for (unsigned int v = 0; v < n_vertices; v++)
+        face_offsets[v + 1] += face_offsets[v];
+    std::vector<unsigned int> fill(face_offsets.begin(), face_offsets.end() - 1);
+    for (unsigned int f = 0; f < n_faces; f++)
+    {
+        for (int j = 0; j < 3; j++)
+            vertex_faces[fill[indices[3 * f + j]]++] = f;
+    }
+}
+
+void NormalKernel::compute(const float *vbuff, float *nbuff)
+{
+    const unsigned int *idx = indices;
+    float *fn = face_normals.data();
+
+    // unit face normals, one writer per face
+#pragma omp parallel for schedule(static)
+    for (int f = 0; f < (int)n_faces; f++)
+    {
+        const float *p0 = vbuff + 3 * idx[3 * f + 0];
+        const float *p1 = vbuff + 3 * idx[3 * f + 1];
+        const float *p2 = vbuff + 3 * idx[3 * f + 2];
+        float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        float n[3] = {
+            e1[1] * e2[2] - e1[2] * e2[1],
+            e1[2] * e2[0] - e1[0] * e2[2],
+            e1[0] * e2[1] - e1[1] * e2[0]};
+        float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        float inv = len > 0.0f ? 1.0f / len : 0.0f;
+        fn[3 * f + 0] = n[0] * inv;
+        fn[3 * f + 1] = n[1] * inv;
+        fn[3 * f + 2] = n[2] * inv;
+    }
+
+    // gather face normals per vertex, one writer per vertex
+    const unsigned int *offsets = face_offsets.data();
+    const unsigned int *faces = vertex_faces.data();
+#pragma omp parallel for schedule(static)
+    for (int v = 0; v < (int)n_vertices; v++)
+    {
+        float n[3] = {0.0f, 0.0f, 0.0f};
+        for (unsigned int k = offsets[v]; k < offsets[v + 1]; k++)
+        {
+            const float *f = fn + 3 * faces[k];
+            n[0] += f[0];
+            n[1] += f[1];
+            n[2] += f[2];
+        }
+        nbuff[3 * v + 0] = n[0];
+        nbuff[3 * v + 1] = n[1];
+        nbuff[3 * v + 2] = n[2];
+    }
+
+    // normalize, branch-free so the loop vectorizes
+#pragma omp parallel for simd schedule(static)
+    for (int v = 0; v < (int)n_vertices; v++)
+    {
+        float x = nbuff[3 * v + 0], y = nbuff[3 * v + 1], z = nbuff[3 * v + 2];
+        float len2 = x * x + y * y + z * z;
+        float inv = 1.0f / std::sqrt(len2 + 1e-30f);
+        nbuff[3 * v + 0] = x * inv;
+        nbuff[3 * v + 1] = y * inv;
+        nbuff[3 * v + 2] = z * inv;
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+
+// Vertex normal kernel on flat vertex / index buffers
+//
+// Vertex normals are the normalized sum of the unit normals of the adjacent
+// faces, as OpenMesh's update_normals computes them. The vertex to face
+// adjacency is built once in CSR form, so each vertex gathers its own sum
+// and the kernel runs in parallel without atomics. The index buffer is not
+// copied and must outlive the kernel.
+class NormalKernel
+{
+private:
+    unsigned int n_vertices;
+    unsigned int n_faces;
+    const unsigned int *indices;            // triangle indices, 3 per face
+    std::vector<unsigned int> face_offsets; // faces of vertex v: vertex_faces[face_offsets[v] .. face_offsets[v + 1])
+    std::vector<unsigned int> vertex_faces;
+    std::vector<float> face_normals;        // 3 floats per face
+
+public:
+    NormalKernel(const unsigned int *ibuff, unsigned int ibuffLen, unsigned int n_vertices);
+
+    void compute(const float *vbuff, float *nbuff); // write 3 floats per vertex to nbuff
+};
@@ -0,0 +1,192 @@
+#include "Offscreen.h"
+#include <EGL/eglext.h>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+// EGL CONTEXT
+EglContext::EglContext(int major, int minor)
+{
+    // surfaceless platform where available, it doesn't need a display server or gpu device
+    display = EGL_NO_DISPLAY;
+    const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (extensions && std::strstr(extensions, "EGL_MESA_platform_surfaceless") && getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint egl_major, egl_minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &egl_major, &egl_minor))
+        throw std::runtime_error("Failed to initialize EGL");
+
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE};
+    EGLConfig config;
+    EGLint n_configs;
+    if (!eglChooseConfig(display, config_attribs, &config, 1, &n_configs) || n_configs < 1)
+    {
+        eglTerminate(display);
+        throw std::runtime_error("No EGL config for desktop OpenGL");
+    }
+
+    const EGLint surface_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    surface = eglCreatePbufferSurface(display, config, surface_attribs);
+
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, major,
+        EGL_CONTEXT_MINOR_VERSION, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE};
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+    {
+        eglTerminate(display);
+        throw std::runtime_error("Failed to create an OpenGL " + std::to_string(major) + "." +
+                                 std::to_string(minor) + " core context");
+    }
+}
+
+EglContext::~EglContext()
+{
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglDestroySurface(display, surface);
+    eglTerminate(display);
+}
+
+void *EglContext::getProcAddress(const char *name) { return (void *)eglGetProcAddress(name); }
+
+// FRAMEBUFFER
+Framebuffer::Framebuffer(unsigned int width, unsigned int height) : _width(width), _height(height)
+{
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, width, height);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &handle);
+    glBindFramebuffer(GL_FRAMEBUFFER, handle);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+        throw std::runtime_error("Incomplete framebuffer");
+}
+
+Framebuffer::~Framebuffer()
+{
+    glDeleteFramebuffers(1, &handle);
+    glDeleteRenderbuffers(1, &color);
+    glDeleteRenderbuffers(1, &depth);
+}
+
+void Framebuffer::bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, handle);
+    glViewport(0, 0, _width, _height);
+}
+
+unsigned int Framebuffer::width() const { return _width; }
+unsigned int Framebuffer::height() const { return _height; }
+Framebuffer::operator GLuint() const { return handle; }
+
+// PIXEL READER
+PixelReader::PixelReader(ImageWriter *writer, unsigned int width, unsigned int height, unsigned int n_buffers)
+    : writer(writer), width(width), height(height), n_buffers(n_buffers), next(0), pending(0), stalls(0)
+{
+    assert(n_buffers >= 1 && n_buffers <= max_buffers);
+    glGenBuffers(n_buffers, pbo);
+    for (unsigned int i = 0; i < n_buffers; i++)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, 4 * (size_t)width * height, nullptr, GL_STREAM_READ);
+        fences[i] = nullptr;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+PixelReader::~PixelReader()
+{
+    for (unsigned int i = 0; i < n_buffers; i++)
+    {
+        if (fences[i])
+            glDeleteSync(fences[i]);
+    }
+    glDeleteBuffers(n_buffers, pbo);
+}
+
+void PixelReader::read()
+{
+    // the ring is full, the oldest read has to make room
+    if (pending == n_buffers)
+    {
+        retire(next);
+        pending--;
+    }
+
+    // rgba is the format drivers read back without conversion
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[next]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    next = (next + 1) % n_buffers;
+    pending++;
+}
+
+void PixelReader::flush()
+{
+    // oldest first, so images reach the writer in order
+    for (; pending > 0; pending--)
+        retire((next + n_buffers - pending) % n_buffers);
+}
+
+void PixelReader::retire(unsigned int index)
+{
+    if (glClientWaitSync(fences[index], 0, 0) == GL_TIMEOUT_EXPIRED)
+    {
+        stalls++;
+        glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    }
+    glDeleteSync(fences[index]);
+    fences[index] = nullptr;
+
+    // a lost frame would shift the numbering of every later image
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[index]);
+    const uint8_t *rgba = (const uint8_t *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4 * (size_t)width * height, GL_MAP_READ_BIT);
+    if (!rgba)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        throw std::runtime_error("Failed to map a pixel buffer");
+    }
+
+    // drop alpha and flip, gl rows start at the bottom
+    uint8_t *rgb = writer->acquire();
+    for (unsigned int y = 0; y < height; y++)
+    {
+        const uint8_t *src = rgba + 4 * (size_t)width * (height - 1 - y);
+        uint8_t *dst = rgb + 3 * (size_t)width * y;
+        for (unsigned int x = 0; x < width; x++)
+        {
+            dst[3 * x] = src[4 * x];
+            dst[3 * x + 1] = src[4 * x + 1];
+            dst[3 * x + 2] = src[4 * x + 2];
+        }
+    }
+    writer->submit();
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+unsigned int PixelReader::stallCount() const { return stalls; }
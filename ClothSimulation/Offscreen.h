@@ -0,0 +1,71 @@
+#pragma once
+#include <glad/glad.h>
+#include <EGL/egl.h>
+
+#include "Shader.h"
+#include "ImageWriter.h"
+
+// Headless OpenGL context through EGL, no window system needed. Prefers the
+// Mesa surfaceless platform and falls back to the default display.
+class EglContext : public NonCopyable
+{
+private:
+    EGLDisplay display;
+    EGLSurface surface; // 1x1 pbuffer, rendering goes to a Framebuffer
+    EGLContext context;
+
+public:
+    EglContext(int major = 4, int minor = 1); // core profile, current after construction, throws std::runtime_error
+    ~EglContext();
+
+    static void *getProcAddress(const char *name); // GLADloadproc
+};
+
+// Framebuffer object with 8-bit sRGB color and depth renderbuffers
+class Framebuffer : public NonCopyable
+{
+private:
+    GLuint handle;
+    GLuint color, depth;
+    unsigned int _width, _height;
+
+public:
+    Framebuffer(unsigned int width, unsigned int height);
+    ~Framebuffer();
+
+    void bind(); // bind for drawing and reading, sets the viewport
+    unsigned int width() const;
+    unsigned int height() const;
+    operator GLuint() const;
+};
+
+// Asynchronous framebuffer readback into an ImageWriter
+//
+// read() starts a glReadPixels into the next pixel buffer of a ring and returns
+// immediately; the buffer is mapped and copied out once the ring wraps around,
+// by then the transfer has usually finished and the map doesn't stall. A
+// buffer that fails to map throws std::runtime_error rather than losing a frame.
+class PixelReader : public NonCopyable
+{
+private:
+    ImageWriter *writer;
+    unsigned int width, height;
+    GLuint pbo[4];
+    GLsync fences[4];
+    unsigned int n_buffers;
+    unsigned int next;     // buffer of the next read
+    unsigned int pending;  // reads not yet copied out
+    unsigned int stalls;   // copies that waited for their transfer
+
+    void retire(unsigned int index); // copy buffer index into the writer
+
+public:
+    static const unsigned int max_buffers = 4;
+
+    PixelReader(ImageWriter *writer, unsigned int width, unsigned int height, unsigned int n_buffers = 3);
+    ~PixelReader();
+
+    void read();  // read the bound framebuffer
+    void flush(); // copy out all pending reads
+    unsigned int stallCount() const;
+};
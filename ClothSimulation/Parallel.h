@@ -0,0 +1,35 @@
+#pragma once
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Parallel loops of the time step
+//
+// libgomp allocates a new thread team for every parallel region run by a
+// single thread, it only keeps teams of several threads. Time steps must not
+// allocate, so their loops only enter a parallel region when OpenMP has more
+// than one thread and run serially otherwise.
+
+inline bool parallelEnabled()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads() > 1;
+#else
+    return false;
+#endif
+}
+
+// body(i) for i in begin .. end - 1, statically scheduled over the threads
+template <class Body>
+inline void parallelFor(int begin, int end, const Body &body)
+{
+    if (parallelEnabled())
+    {
+#pragma omp parallel for schedule(static)
+        for (int i = begin; i < end; i++)
+            body(i);
+        return;
+    }
+    for (int i = begin; i < end; i++)
+        body(i);
+}
@@ -2,7 +2,7 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 
-Renderer::Renderer() {}
+Renderer::Renderer() : framebuffer(0) {}
 
 void Renderer::setProgram(GLProgram *program)
 {
@@ -39,16 +39,23 @@ void Renderer::setElementCount(unsigned int n_elements)
     this->n_elements = n_elements;
 }
 
+void Renderer::setFramebuffer(GLuint framebuffer)
+{
+    this->framebuffer = framebuffer;
+}
+
 void Renderer::draw()
 {
     assert(program != nullptr);
     assert((*program) > 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
     glUseProgram(*program);
     glBindVertexArray(*input);
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
     glEnableVertexAttribArray(2);
     glDrawElements(GL_TRIANGLES, n_elements, GL_UNSIGNED_INT, 0);
+    input->fence();
     glDisableVertexAttribArray(0);
     glDisableVertexAttribArray(1);
     glDisableVertexAttribArray(2);
@@ -8,6 +8,7 @@ public:
     GLProgram *program;
     ProgramInput *input;
     unsigned int n_elements;
+    GLuint framebuffer; // draw target, 0 is the window
 
 public:
     Renderer();
@@ -17,6 +18,7 @@ public:
     void setModelview(const glm::mat4 &mv);
     void setProjection(const glm::mat4 &p);
     void setElementCount(unsigned int n_elements);
+    void setFramebuffer(GLuint framebuffer);
 
     void draw();
 };
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include "Scene.h"
+#include "Sleep.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static const unsigned int g_fade_frames = 8; // frames over which a level switch fades in
+
+// SCENE DESCRIPTION
+void SceneDescription::load(const char *path)
+{
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error(std::string("Failed to open scene ") + path);
+
+    std::string line;
+    unsigned int line_no = 0;
+    while (std::getline(in, line))
+    {
+        line_no++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        std::string key;
+        if (!(tokens >> key))
+            continue;
+
+        bool ok = true;
+        if (key == "grid")
+            ok = (bool)(tokens >> n) && n % 2 == 1 && n >= 3;
+        else if (key == "width")
+            ok = (bool)(tokens >> width);
+        else if (key == "time_step")
+            ok = (bool)(tokens >> time_step);
+        else if (key == "rest_scale")
+            ok = (bool)(tokens >> rest_scale);
+        else if (key == "stiffness")
+            ok = (bool)(tokens >> stiffness);
+        else if (key == "mass")
+            ok = (bool)(tokens >> mass);
+        else if (key == "damping")
+            ok = (bool)(tokens >> damping);
+        else if (key == "gravity")
+            ok = (bool)(tokens >> gravity);
+        else if (key == "iterations")
+            ok = (bool)(tokens >> iterations);
+        else if (key == "substeps")
+            ok = (bool)(tokens >> substeps);
+        else if (key == "frames")
+            ok = (bool)(tokens >> frames);
+        else if (key == "deformation")
+            ok = (bool)(tokens >> tauc >> deform_iterations);
+        else if (key == "adaptive")
+        {
+            adaptive = true;
+            ok = (bool)(tokens >> min_iterations >> max_iterations >> iteration_tol >> iteration_abs_tol) &&
+                 min_iterations >= 1 && min_iterations <= max_iterations;
+        }
+        else if (key == "solver")
+        {
+            std::string name;
+            ok = (bool)(tokens >> name) && LinearSolver::parse(name, solver);
+        }
+        else if (key == "multires")
+        {
+            levels = 2;
+            level = 1;
+            ok = (bool)(tokens >> detail_iterations);
+        }
+        else if (key == "lod")
+        {
+            level = 0;
+            ok = (bool)(tokens >> levels >> detail_iterations) && levels >= 1 && levels <= 16;
+        }
+        else if (key == "sleep")
+            ok = (bool)(tokens >> sleep_speed >> sleep_steps) && sleep_speed > 0.0f;
+        else if (key == "pin")
+        {
+            unsigned int i;
+            ok = (bool)(tokens >> i);
+            pins.push_back(i);
+        }
+        else if (key == "sphere")
+        {
+            Sphere sphere;
+            ok = (bool)(tokens >> sphere.center[0] >> sphere.center[1] >> sphere.center[2] >> sphere.radius);
+            spheres.push_back(sphere);
+        }
+        else
+            ok = false;
+
+        if (!ok)
+            throw std::runtime_error(std::string(path) + ":" + std::to_string(line_no) + ": invalid entry '" + key + "'");
+    }
+
+    for (unsigned int i : pins)
+    {
+        if (i >= n * n)
+            throw std::runtime_error(std::string(path) + ": pin index out of range");
+    }
+    if ((n - 1) % (1u << levels) != 0)
+        throw std::runtime_error(std::string(path) + ": " + std::to_string(levels) +
+                                 " levels need a grid with n - 1 divisible by " + std::to_string(1u << levels));
+}
+
+// SCENE
+Scene::Scene(const SceneDescription &desc) : active(desc.level), fade_frames(0), desc(desc)
+{
+    // cloth mesh
+    MeshBuilder meshBuilder;
+    meshBuilder.uniformGrid(desc.width, desc.n);
+    mesh = meshBuilder.getResult();
+
+    // level chain, a single level simulates the mesh itself
+    levels.resize(desc.levels);
+    for (unsigned int k = 0; k < desc.levels; k++)
+    {
+        Level &level = levels[k];
+        level.n = (desc.n - 1) / (1u << k) + 1;
+        if (desc.levels > 1)
+            level.positions.resize(3 * level.n * level.n);
+        level.upsampler = k == 0 ? nullptr
+                                 : new GridUpsampler(levels[k - 1].n, levelSpacing(k - 1) * desc.rest_scale);
+    }
+    if (desc.levels > 1)
+    {
+        std::copy(mesh->vbuff(), mesh->vbuff() + mesh->vbuffLen(), positions(0));
+        for (unsigned int k = 1; k < desc.levels; k++)
+            levels[k].upsampler->downsample(positions(k - 1), positions(k));
+    }
+    for (unsigned int k = 0; k < desc.levels; k++)
+        buildLevel(k);
+
+    system = levels[active].system;
+    solver = levels[active].solver;
+    root = levels[active].root;
+    fixer = levels[active].fixer;
+    if (active > 0)
+        updateMesh();
+}
+
+void Scene::buildLevel(unsigned int k)
+{
+    Level &level = levels[k];
+    const unsigned int n = level.n;
+    const float m = desc.mass / (n * n); // point mass
+    const float d = levelSpacing(k);     // grid spacing
+    float *q = positions(k);
+
+    // mass spring system
+    MassSpringBuilder massSpringBuilder;
+    massSpringBuilder.uniformGrid(n, desc.time_step, d * desc.rest_scale, desc.stiffness,
+                                  m, desc.damping, desc.gravity * m);
+    level.system = massSpringBuilder.getResult();
+    level.solver = new MassSpringSolver(level.system, q, desc.solver);
+    if (desc.sleep_speed > 0.0f)
+        level.solver->enableSleeping(desc.sleep_speed, desc.sleep_steps);
+
+    // constraint graph
+    level.root = new CgRootNode(level.system, q);
+    level.fixer = new CgPointFixNode(level.system, q);
+    nodes.push_back(level.root);
+    nodes.push_back(level.fixer);
+    for (unsigned int i : desc.pins)
+        level.fixer->fixPoint(n * (i / desc.n >> k) + (i % desc.n >> k));
+
+    CgSpringNode *parent = level.root;
+    if (desc.tauc > 0.0f)
+    {
+        CgSpringDeformationNode *deformationNode =
+            new CgSpringDeformationNode(level.system, q, desc.tauc, desc.deform_iterations);
+        deformationNode->addSprings(massSpringBuilder.getShearIndex());
+        deformationNode->addSprings(massSpringBuilder.getStructIndex());
+        level.root->addChild(deformationNode);
+        nodes.push_back(deformationNode);
+        parent = deformationNode;
+    }
+    parent->addChild(level.fixer);
+
+    for (const SceneDescription::Sphere &sphere : desc.spheres)
+    {
+        CgSphereCollisionNode *sphereCollisionNode = new CgSphereCollisionNode(
+            level.system, q, sphere.radius,
+            Eigen::Vector3f(sphere.center[0], sphere.center[1], sphere.center[2]));
+        level.root->addChild(sphereCollisionNode);
+        nodes.push_back(sphereCollisionNode);
+    }
+}
+
+Scene::~Scene()
+{
+    for (CgNode *node : nodes)
+        delete node;
+    for (Level &level : levels)
+    {
+        delete level.upsampler;
+        delete level.solver;
+        delete level.system;
+    }
+    delete mesh;
+}
+
+float *Scene::positions(unsigned int k)
+{
+    return levels[k].positions.empty() ? mesh->vbuff() : levels[k].positions.data();
+}
+
+void Scene::step()
+{
+    CgSatisfyVisitor visitor;
+    for (unsigned int i = 0; i < desc.substeps; i++)
+    {
+        if (desc.adaptive)
+            solver->solveAdaptive(desc.min_iterations, desc.max_iterations,
+                                  desc.iteration_tol, desc.iteration_abs_tol);
+        else
+            solver->solve(desc.iterations);
+        visitor.satisfy(*root);
+    }
+    if (levels.size() > 1)
+        updateMesh();
+}
+
+void Scene::updateMesh()
+{
+    float *v = vbuff();
+    if (active == 0)
+        std::copy(positions(0), positions(0) + mesh->vbuffLen(), v);
+    else
+    {
+        // prolongate level by level, the intermediate grids are scratch
+        for (unsigned int k = active; k > 1; k--)
+            levels[k].upsampler->upsample(positions(k), positions(k - 1));
+        levels[1].upsampler->upsample(positions(1), v);
+        levels[1].upsampler->relax(v, desc.detail_iterations);
+
+        // keep the reconstructed detail out of the colliders
+        for (const SceneDescription::Sphere &sphere : desc.spheres)
+        {
+            const Eigen::Vector3f center(sphere.center[0], sphere.center[1], sphere.center[2]);
+            for (unsigned int i = 0; i < mesh->n_vertices(); i++)
+            {
+                Eigen::Map<Eigen::Vector3f> p(v + 3 * i);
+                Eigen::Vector3f offset = p - center;
+                if (offset.squaredNorm() < sphere.radius * sphere.radius)
+                    p = center + sphere.radius * offset.normalized();
+            }
+        }
+    }
+
+    // fade out the jump of a level switch
+    if (fade_frames > 0)
+    {
+        const float s = (float)fade_frames / (g_fade_frames + 1);
+        for (unsigned int i = 0; i < mesh->vbuffLen(); i++)
+            v[i] += s * offset[i];
+        fade_frames--;
+    }
+}
+
+// LEVELS
+unsigned int Scene::levelCount() const { return (unsigned int)levels.size(); }
+unsigned int Scene::level() const { return active; }
+float Scene::levelSpacing(unsigned int k) const { return desc.width / (levels[k].n - 1); }
+
+void Scene::setLevel(unsigned int k)
+{
+    if (k >= levels.size())
+        throw std::runtime_error("Scene level out of range");
+    if (k == active)
+        return;
+
+    // restriction samples the coarse nodes, prolongation interpolates
+    for (unsigned int l = active; l < k; l++)
+    {
+        levels[l + 1].upsampler->downsample(positions(l), positions(l + 1));
+        levels[l + 1].upsampler->downsample(levels[l].solver->previousState(), levels[l + 1].solver->previousState());
+    }
+    for (unsigned int l = active; l > k; l--)
+    {
+        levels[l].upsampler->upsample(positions(l), positions(l - 1));
+        levels[l].upsampler->upsample(levels[l].solver->previousState(), levels[l - 1].solver->previousState());
+    }
+
+    if (levels[k].solver->getSleep())
+        levels[k].solver->getSleep()->wakeAll();
+
+    // displayed mesh before and after the switch
+    offset.assign(mesh->vbuff(), mesh->vbuff() + mesh->vbuffLen());
+    active = k;
+    system = levels[k].system;
+    solver = levels[k].solver;
+    root = levels[k].root;
+    fixer = levels[k].fixer;
+    fade_frames = 0;
+    updateMesh();
+    float *v = vbuff();
+    for (unsigned int i = 0; i < mesh->vbuffLen(); i++)
+    {
+        offset[i] -= v[i];
+        v[i] += offset[i];
+    }
+    fade_frames = g_fade_frames;
+}
+
+float *Scene::vbuff() { return mesh->vbuff(); }
+unsigned int Scene::vbuffLen() const { return mesh->vbuffLen(); }
+
+void Scene::writeObj(const char *path) const
+{
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error(std::string("Failed to open ") + path);
+    const float *v = mesh->vbuff();
+    const unsigned int *f = mesh->ibuff();
+    for (unsigned int i = 0; i < mesh->vbuffLen(); i += 3)
+        out << "v " << v[i] << " " << v[i + 1] << " " << v[i + 2] << "\n";
+    for (unsigned int i = 0; i < mesh->ibuffLen(); i += 3)
+        out << "f " << f[i] + 1 << " " << f[i + 1] + 1 << " " << f[i + 2] + 1 << "\n";
+}
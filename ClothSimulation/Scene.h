@@ -0,0 +1,129 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "MassSpringSolver.h"
+#include "Mesh.h"
+#include "Multiresolution.h"
+
+// Scene description
+//
+// Scene files are plain text, one "key values..." entry per line, '#' starts
+// a comment. Keys and defaults match the viewer's curtain demos:
+//   grid n                  grid width, must be odd              | 33
+//   width w                 cloth width                          | 2.0
+//   time_step h             time step                            | 0.008
+//   rest_scale s            rest length / grid spacing           | 1.05
+//   stiffness k             spring stiffness                     | 1.0
+//   mass m                  total cloth mass                     | 0.25
+//   damping a               damping factor                       | 0.993
+//   gravity g               gravitational acceleration           | 9.8
+//   iterations i            solver iterations per time step      | 5
+//   substeps s              time steps per frame                 | 2
+//   frames f                number of frames to simulate         | 300
+//   deformation tauc iter   spring deformation constraint        | off
+//   adaptive min max tol abs_tol  adaptive iterations, see MassSpringSolver::solveAdaptive | off
+//   solver name             global step solver: cholesky, banded, multigrid or supernodal | cholesky
+//   multires iterations     simulate the (n + 1) / 2 grid and upsample, see GridUpsampler | off
+//   lod levels iterations   levels grids n, (n + 1) / 2, ... selected with Scene::setLevel | off
+//   sleep speed steps       regions slower than speed for steps time steps sleep, see RegionSleep | off
+//   pin i                   fix point i, repeatable
+//   sphere x y z r          sphere collider, repeatable
+struct SceneDescription
+{
+    struct Sphere
+    {
+        float center[3];
+        float radius;
+    };
+
+    unsigned int n = 33;
+    float width = 2.0f;
+    float time_step = 0.008f;
+    float rest_scale = 1.05f;
+    float stiffness = 1.0f;
+    float mass = 0.25f;
+    float damping = 0.993f;
+    float gravity = 9.8f;
+    unsigned int iterations = 5;
+    unsigned int substeps = 2;
+    unsigned int frames = 300;
+    float tauc = 0.0f;              // critical deformation rate, 0 disables the constraint
+    unsigned int deform_iterations = 15;
+    bool adaptive = false;          // adaptive iteration count instead of iterations
+    unsigned int min_iterations = 1;
+    unsigned int max_iterations = 10;
+    float iteration_tol = 0.05f;
+    float iteration_abs_tol = 1e-5f;
+    LinearSolver::Type solver = LinearSolver::Cholesky;
+    unsigned int levels = 1;        // grids in the level chain, each needs an odd width
+    unsigned int level = 0;         // initial level, 1 in multires mode
+    unsigned int detail_iterations = 0; // relaxation sweeps after upsampling a coarse level
+    float sleep_speed = 0.0f;       // RMS speed below which regions fall asleep, 0 disables sleeping
+    unsigned int sleep_steps = 60;
+    std::vector<unsigned int> pins;
+    std::vector<Sphere> spheres;
+
+    void load(const char *path); // throws std::runtime_error on malformed files
+};
+
+// Simulation scene built from a description, no rendering dependencies
+//
+// A scene with several levels prebuilds a system, solver and constraint graph
+// for every grid of its chain, level 0 being the finest, and simulates one of
+// them. The mesh stays at full resolution: step() upsamples a coarse level
+// into it. setLevel() transfers the current and previous positions by
+// restriction or prolongation, so velocities carry over, and fades the jump
+// in the displayed mesh out over a few frames. Pins map to the nearest coarse
+// node at or before them. system, solver, root and fixer are the active
+// level's.
+class Scene
+{
+private:
+    struct Level
+    {
+        unsigned int n;               // grid width
+        std::vector<float> positions; // simulated positions, the mesh for a single level
+        mass_spring_system *system;
+        MassSpringSolver *solver;
+        CgRootNode *root;
+        CgPointFixNode *fixer;
+        GridUpsampler *upsampler;     // onto the next finer grid, nullptr for level 0
+    };
+
+    std::vector<CgNode *> nodes;     // owned constraint nodes of all levels
+    std::vector<Level> levels;
+    unsigned int active;             // simulated level
+    std::vector<float> offset;       // displayed jump of the last level switch
+    unsigned int fade_frames;        // frames left to fade the offset out
+
+    void buildLevel(unsigned int k);
+    float *positions(unsigned int k);
+    void updateMesh(); // mesh from the active level
+
+public:
+    SceneDescription desc;
+    Mesh *mesh;                      // cloth grid from MeshBuilder::uniformGrid
+    mass_spring_system *system;
+    MassSpringSolver *solver;
+    CgRootNode *root;                // constraint graph
+    CgPointFixNode *fixer;           // pinned points
+
+    Scene(const SceneDescription &desc);
+    Scene(const Scene &other) = delete;
+    Scene &operator=(const Scene &other) = delete;
+    ~Scene();
+
+    void step(); // advance one frame: substeps time steps, constraints after each
+
+    // levels
+    unsigned int levelCount() const;
+    unsigned int level() const;
+    void setLevel(unsigned int k);
+    float levelSpacing(unsigned int k) const; // grid spacing of level k
+
+    float *vbuff();
+    unsigned int vbuffLen() const;
+
+    void writeObj(const char *path) const;
+};
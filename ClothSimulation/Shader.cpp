@@ -1,4 +1,6 @@
 #include "Shader.h"
+#include <cstddef>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <glm/gtc/type_ptr.hpp>
@@ -40,7 +42,7 @@ void GLShader::compile(std::ifstream &source)
     std::vector<char> text;
     source.seekg(0, std::ios_base::end);
     std::streampos fileSize = source.tellg();
-    text.resize(fileSize);
+    text.resize((size_t)fileSize + 1, '\0'); // null terminated
 
     source.seekg(0, std::ios_base::beg);
     source.read(&text[0], fileSize);
@@ -94,31 +96,138 @@ GLProgram::operator GLuint() const { return handle; }
 
 GLProgram::~GLProgram() { glDeleteProgram(handle); }
 
+// STREAM BUFFER
+// GL_ARB_buffer_storage is core in 4.4, the glad loader only covers 4.1
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void(APIENTRY *BufferStorageProc)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+static BufferStorageProc bufferStorage = nullptr;
+
+void StreamBuffer::loadExtensions(GLADloadproc load)
+{
+    GLint n_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n_extensions);
+    for (GLint i = 0; i < n_extensions; i++)
+    {
+        if (std::strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_buffer_storage") == 0)
+            bufferStorage = (BufferStorageProc)load("glBufferStorage");
+    }
+}
+
+bool StreamBuffer::persistentSupported() { return bufferStorage != nullptr; }
+
+StreamBuffer::Mode StreamBuffer::best() { return persistentSupported() ? Persistent : Orphan; }
+
+const char *StreamBuffer::name(Mode mode)
+{
+    static const char *names[] = {"static", "orphan", "persistent"};
+    return names[mode];
+}
+
+StreamBuffer::StreamBuffer(Mode mode, size_t size, unsigned int n_regions)
+    : _mode(mode), size(size), stride(size), n_regions(1), region(0), mapping(nullptr),
+      fences(), stalls(0)
+{
+    if (mode == Persistent && !persistentSupported())
+        throw std::runtime_error("GL_ARB_buffer_storage is not supported.");
+    assert(n_regions >= 1 && n_regions <= max_regions);
+
+    glGenBuffers(1, &handle);
+    glBindBuffer(GL_ARRAY_BUFFER, handle);
+    if (mode == Persistent)
+    {
+        // regions start on 256 byte boundaries
+        this->stride = (size + 255) & ~size_t(255);
+        this->n_regions = n_regions;
+        this->region = n_regions - 1; // first upload goes to region 0
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        bufferStorage(GL_ARRAY_BUFFER, stride * n_regions, nullptr, flags);
+        mapping = (char *)glMapBufferRange(GL_ARRAY_BUFFER, 0, stride * n_regions, flags);
+        if (!mapping)
+            throw std::runtime_error("Failed to map stream buffer.");
+    }
+    else
+        glBufferData(GL_ARRAY_BUFFER, size, nullptr, mode == Static ? GL_STATIC_DRAW : GL_STREAM_DRAW);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for (GLsync sync : fences)
+    {
+        if (sync)
+            glDeleteSync(sync);
+    }
+    if (mapping)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, handle);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    glDeleteBuffers(1, &handle);
+}
+
+size_t StreamBuffer::upload(const void *data)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, handle);
+    if (_mode == Static)
+    {
+        glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+        return 0;
+    }
+    if (_mode == Orphan)
+    {
+        glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+        return 0;
+    }
+
+    // next ring region, wait until the draws reading it are done
+    region = (region + 1) % n_regions;
+    if (GLsync sync = fences[region])
+    {
+        if (glClientWaitSync(sync, 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            while (glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                ;
+            stalls++;
+        }
+        glDeleteSync(sync);
+        fences[region] = nullptr;
+    }
+    std::memcpy(mapping + stride * region, data, size);
+    return stride * region;
+}
+
+void StreamBuffer::fence()
+{
+    if (_mode != Persistent)
+        return;
+    if (fences[region])
+        glDeleteSync(fences[region]);
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+StreamBuffer::Mode StreamBuffer::mode() const { return _mode; }
+unsigned int StreamBuffer::stallCount() const { return stalls; }
+StreamBuffer::operator GLuint() const { return handle; }
+
 // PROGRAM INPUT
-ProgramInput::ProgramInput()
+ProgramInput::ProgramInput(StreamBuffer::Mode stream_mode) : stream_mode(stream_mode), streams(), stream_size()
 {
     // generate buffers
-    glGenBuffers(4, &vbo[0]);
+    glGenBuffers(2, &vbo[0]);
 
     // generate vertex array object
     glGenVertexArrays(1, &handle);
     glBindVertexArray(handle);
 
-    // positions
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-    // normals
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-    // texture coordinates
-    // positions
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[2]);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    // vertex attributes are pointed at their buffers when the data is set
 
     // indices
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[3]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[1]);
 
     glBindVertexArray(0);
 }
@@ -129,24 +238,77 @@ void ProgramInput::bufferDate(unsigned int index, void *buff, size_t size)
     glBufferData(GL_ARRAY_BUFFER, size, buff, GL_STATIC_DRAW);
 }
 
+size_t ProgramInput::streamData(unsigned int index, const void *buff, size_t size)
+{
+    StreamBuffer *&stream = streams[index];
+    if (!stream || stream->mode() != stream_mode || stream_size[index] != size)
+    {
+        delete stream;
+        stream = new StreamBuffer(stream_mode, size);
+        stream_size[index] = size;
+    }
+    return stream->upload(buff);
+}
+
+void ProgramInput::attribPointer(GLuint buffer, unsigned int attrib, GLint size, GLenum type,
+                                 GLboolean normalized, GLsizei stride, size_t offset)
+{
+    glBindVertexArray(handle);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(attrib, size, type, normalized, stride, (void *)offset);
+    glBindVertexArray(0);
+}
+
 void ProgramInput::setPositionData(float *buff, unsigned int len)
 {
-    bufferDate(0, buff, sizeof(float) * len);
+    size_t offset = streamData(0, buff, sizeof(float) * len);
+    attribPointer(*streams[0], 0, 3, GL_FLOAT, GL_FALSE, 0, offset);
 }
 
 void ProgramInput::setNormalData(float *buff, unsigned int len)
 {
-    bufferDate(1, buff, sizeof(float) * len);
+    size_t offset = streamData(1, buff, sizeof(float) * len);
+    attribPointer(*streams[1], 1, 3, GL_FLOAT, GL_FALSE, 0, offset);
 }
 
 void ProgramInput::setTextureDate(float *buff, unsigned int len)
 {
-    bufferDate(2, buff, sizeof(float) * len);
+    bufferDate(0, buff, sizeof(float) * len);
+    attribPointer(vbo[0], 2, 2, GL_FLOAT, GL_FALSE, 0, 0);
+}
+
+void ProgramInput::setPackedVertexData(PackedVertex *buff, unsigned int n_vertices)
+{
+    size_t offset = streamData(0, buff, sizeof(PackedVertex) * n_vertices);
+    attribPointer(*streams[0], 0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex),
+                  offset + offsetof(PackedVertex, position));
+    attribPointer(*streams[0], 1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex),
+                  offset + offsetof(PackedVertex, normal));
+}
+
+void ProgramInput::setPackedTextureData(uint16_t *buff, unsigned int n_vertices)
+{
+    bufferDate(0, buff, 2 * sizeof(uint16_t) * n_vertices);
+    attribPointer(vbo[0], 2, 2, GL_HALF_FLOAT, GL_FALSE, 0, 0);
 }
 
 void ProgramInput::setIndexData(unsigned int *buff, unsigned int len)
 {
-    bufferDate(3, buff, sizeof(unsigned int) * len);
+    bufferDate(1, buff, sizeof(unsigned int) * len);
+}
+
+void ProgramInput::fence()
+{
+    for (StreamBuffer *stream : streams)
+    {
+        if (stream)
+            stream->fence();
+    }
+}
+
+unsigned int ProgramInput::streamStalls() const
+{
+    return (streams[0] ? streams[0]->stallCount() : 0) + (streams[1] ? streams[1]->stallCount() : 0);
 }
 
 ProgramInput::operator GLuint() const
@@ -156,7 +318,9 @@ ProgramInput::operator GLuint() const
 
 ProgramInput::~ProgramInput()
 {
-    glDeleteBuffers(4, vbo);
+    delete streams[0];
+    delete streams[1];
+    glDeleteBuffers(2, vbo);
     glDeleteVertexArrays(1, &handle);
 }
 
@@ -194,19 +358,3 @@ void PhongShader::setLight(const glm::vec3 &light)
     glUniform3f(uLight, light[0], light[1], light[2]);
     glUseProgram(0);
 }
-
-PickShader::PickShader() : GLProgram() {}
-
-void PickShader::postLink()
-{
-    // get uniforms
-    uTessFact = glGetUniformLocation(handle, "uTessFact");
-}
-
-void PickShader::setTessFact(unsigned int n)
-{
-    assert(uTessFact >= 0);
-    glUseProgram(*this);
-    glUniform1i(uTessFact, n);
-    glUseProgram(0);
-}
\ No newline at end of file
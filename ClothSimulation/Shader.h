@@ -3,6 +3,7 @@
 // #include <GL/glew.h>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "VertexFormat.h"
 
 class NonCopyable
 {
@@ -45,21 +46,84 @@ public:
     ~GLProgram();
 };
 
+// Vertex buffer for data that changes every frame
+//
+// Static reallocates the buffer with glBufferData on every upload (the old
+// behavior). Orphan detaches the old storage with glBufferData(NULL) before
+// glBufferSubData, so the driver never waits for draws still reading it.
+// Persistent keeps a ring of regions in one GL_ARB_buffer_storage buffer
+// mapped for the buffer's lifetime, writes the next region directly and
+// waits on a fence only when the GPU is still reading that region.
+class StreamBuffer : public NonCopyable
+{
+public:
+    enum Mode
+    {
+        Static,
+        Orphan,
+        Persistent
+    };
+
+private:
+    GLuint handle;
+    Mode _mode;
+    size_t size;             // bytes per upload
+    size_t stride;           // bytes per ring region
+    unsigned int n_regions;  // ring regions, 1 unless persistent
+    unsigned int region;     // region of the last upload
+    char *mapping;           // persistent mapping
+    GLsync fences[4];        // fence per region after its last draw
+
+    unsigned int stalls;     // uploads that waited for a fence
+
+public:
+    static const unsigned int max_regions = 4;
+
+    // load GL_ARB_buffer_storage, call after gladLoadGLLoader
+    static void loadExtensions(GLADloadproc load);
+    static bool persistentSupported();
+    static Mode best(); // Persistent if supported, else Orphan
+    static const char *name(Mode mode);
+
+    StreamBuffer(Mode mode, size_t size, unsigned int n_regions = 3);
+    ~StreamBuffer();
+
+    size_t upload(const void *data); // returns the byte offset of the uploaded data
+    void fence();                    // call after the draws that read the last upload
+
+    Mode mode() const;
+    unsigned int stallCount() const;
+    operator GLuint() const;
+};
+
 class ProgramInput : public NonCopyable
 {
 private:
     GLuint handle; // vertex array object handle
-    GLuint vbo[4]; // vertex buffer object handles | position, normal, texture, index
+    GLuint vbo[2]; // vertex buffer object handles | texture, index
+    StreamBuffer::Mode stream_mode;
+    StreamBuffer *streams[2]; // streamed position and normal buffers
+    size_t stream_size[2];
     void bufferDate(unsigned int index, void *buff, size_t size);
+    size_t streamData(unsigned int index, const void *buff, size_t size); // returns the buffer offset
+    void attribPointer(GLuint buffer, unsigned int attrib, GLint size, GLenum type,
+                       GLboolean normalized, GLsizei stride, size_t offset);
 
 public:
-    ProgramInput();
+    ProgramInput(StreamBuffer::Mode stream_mode = StreamBuffer::best());
 
     void setPositionData(float *buff, unsigned int len);
     void setNormalData(float *buff, unsigned int len);
     void setTextureDate(float *buff, unsigned int len);
     void setIndexData(unsigned int *buff, unsigned int len);
 
+    // packed format, use with packed.vshader instead of the position, normal and texture setters
+    void setPackedVertexData(PackedVertex *buff, unsigned int n_vertices);
+    void setPackedTextureData(uint16_t *buff, unsigned int n_vertices);
+
+    void fence(); // call after drawing, see StreamBuffer::fence
+    unsigned int streamStalls() const;
+
     operator GLuint() const;
 
     ~ProgramInput();
@@ -78,14 +142,3 @@ public:
     void setAmbient(const glm::vec3 &ambient);
     void setLight(const glm::vec3 &light);
 };
-
-class PickShader : public GLProgram
-{
-private:
-    GLuint uTessFact;
-
-public:
-    PickShader();
-    virtual void postLink();
-    void setTessFact(unsigned int n);
-};
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "Sleep.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+RegionSleep::RegionSleep(const mass_spring_system *system, float sleep_speed, unsigned int quiet_steps,
+                         unsigned int region_width)
+    : region_of(system->n_points), n_asleep(0), springs_dirty(false), spring_version(0), system(system),
+      sleep_speed(sleep_speed), quiet_steps(quiet_steps)
+{
+    assert(region_width >= 1);
+    const unsigned int n_points = system->n_points;
+
+    // tiles of a grid, runs of region_width^2 points otherwise
+    const unsigned int n = system->grid_n;
+    if (n > 0)
+    {
+        const unsigned int tiles = (n + region_width - 1) / region_width;
+        n_regions = tiles * tiles;
+        for (unsigned int p = 0; p < n_points; p++)
+            region_of[p] = tiles * (p / n / region_width) + p % n / region_width;
+    }
+    else
+    {
+        const unsigned int run = region_width * region_width;
+        n_regions = (n_points + run - 1) / run;
+        for (unsigned int p = 0; p < n_points; p++)
+            region_of[p] = p / run;
+    }
+
+    // points per region
+    point_offsets.assign(n_regions + 1, 0);
+    for (unsigned int p = 0; p < n_points; p++)
+        point_offsets[region_of[p] + 1]++;
+    for (unsigned int r = 0; r < n_regions; r++)
+        point_offsets[r + 1] += point_offsets[r];
+    points.resize(n_points);
+    std::vector<unsigned int> fill(point_offsets.begin(), point_offsets.end() - 1);
+    for (unsigned int p = 0; p < n_points; p++)
+        points[fill[region_of[p]]++] = p;
+
+    region_masses.assign(n_regions, 0.0f);
+    for (unsigned int p = 0; p < n_points; p++)
+        region_masses[region_of[p]] += system->masses[p];
+
+    // neighboring regions share a spring
+    std::vector<std::vector<unsigned int>> adjacent(n_regions);
+    for (const mass_spring_system::Edge &spring : system->spring_list)
+    {
+        unsigned int a = region_of[spring.first], b = region_of[spring.second];
+        if (a != b)
+        {
+            adjacent[a].push_back(b);
+            adjacent[b].push_back(a);
+        }
+    }
+    neighbor_offsets.assign(1, 0);
+    for (std::vector<unsigned int> &list : adjacent)
+    {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        neighbors.insert(neighbors.end(), list.begin(), list.end());
+        neighbor_offsets.push_back((unsigned int)neighbors.size());
+    }
+
+    speeds.assign(n_regions, 0.0f);
+    quiet.assign(n_regions, 0);
+    asleep.assign(n_regions, 0);
+    point_awake.assign(n_points, 1);
+    spring_awake.assign(system->n_springs, 1);
+}
+
+void RegionSleep::setAsleep(unsigned int r, bool sleep)
+{
+    if (asleep[r] == sleep)
+        return;
+    asleep[r] = sleep;
+    if (sleep)
+        n_asleep++;
+    else
+        n_asleep--;
+    quiet[r] = 0;
+    for (unsigned int k = point_offsets[r]; k < point_offsets[r + 1]; k++)
+        point_awake[points[k]] = !sleep;
+    springs_dirty = true;
+}
+
+void RegionSleep::update(const float *q, const float *q_prev)
+{
+    // mass weighted RMS speed of the awake regions
+    const float h = system->time_step;
+    for (unsigned int r = 0; r < n_regions; r++)
+    {
+        if (asleep[r])
+        {
+            speeds[r] = 0.0f;
+            continue;
+        }
+        float sum = 0.0f;
+        for (unsigned int k = point_offsets[r]; k < point_offsets[r + 1]; k++)
+        {
+            const unsigned int p = points[k];
+            const float dx = q[3 * p] - q_prev[3 * p];
+            const float dy = q[3 * p + 1] - q_prev[3 * p + 1];
+            const float dz = q[3 * p + 2] - q_prev[3 * p + 2];
+            sum += system->masses[p] * (dx * dx + dy * dy + dz * dz);
+        }
+        speeds[r] = std::sqrt(sum / region_masses[r]) / h;
+    }
+
+    // wake the neighbors of fast regions first, so a region does not fall
+    // asleep next to one that is moving into it
+    for (unsigned int r = 0; r < n_regions; r++)
+    {
+        if (speeds[r] <= 2.0f * sleep_speed)
+            continue;
+        for (unsigned int k = neighbor_offsets[r]; k < neighbor_offsets[r + 1]; k++)
+            setAsleep(neighbors[k], false);
+    }
+    for (unsigned int r = 0; r < n_regions; r++)
+    {
+        if (asleep[r])
+            continue;
+        quiet[r] = speeds[r] < sleep_speed ? quiet[r] + 1 : 0;
+        if (quiet[r] >= quiet_steps)
+            setAsleep(r, true);
+    }
+
+    if (springs_dirty)
+        updateSprings();
+}
+
+void RegionSleep::updateSprings()
+{
+    const unsigned int n_springs = system->n_springs;
+    for (unsigned int k = 0; k < n_springs; k++)
+    {
+        const mass_spring_system::Edge &spring = system->spring_list[k];
+        spring_awake[k] = point_awake[spring.first] | point_awake[spring.second];
+    }
+    springs_dirty = false;
+    spring_version++;
+}
+
+void RegionSleep::wakePoint(unsigned int i)
+{
+    const unsigned int r = region_of[i];
+    setAsleep(r, false);
+    quiet[r] = 0;
+    if (springs_dirty)
+        updateSprings();
+}
+
+void RegionSleep::wakeAll()
+{
+    for (unsigned int r = 0; r < n_regions; r++)
+        setAsleep(r, false);
+    if (springs_dirty)
+        updateSprings();
+}
+
+const unsigned char *RegionSleep::pointMask() const { return point_awake.data(); }
+const unsigned char *RegionSleep::springMask() const { return spring_awake.data(); }
+unsigned long RegionSleep::springVersion() const { return spring_version; }
+bool RegionSleep::allAsleep() const { return n_asleep == n_regions; }
+unsigned int RegionSleep::regionCount() const { return n_regions; }
+unsigned int RegionSleep::sleepingRegions() const { return n_asleep; }
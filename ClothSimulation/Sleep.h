@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+
+#include "MassSpringSolver.h"
+
+// Sleeping regions of a mass spring system
+//
+// Points are grouped into regions, square tiles of a grid built by
+// MassSpringBuilder::uniformGrid or runs of consecutive indices otherwise.
+// update() measures each awake region's RMS speed from the last time step; a
+// region that stays below sleep_speed for quiet_steps time steps falls
+// asleep, a sleeping region wakes when a neighboring region moves faster than
+// twice sleep_speed or when wakePoint() is called for one of its points, the
+// masks are current as soon as it does. A spring is awake while either end is. Sleeping points are frozen at rest:
+// the solver holds them like pins and adds the fixed forces of sleeping
+// springs without projecting them, the constraint nodes skip them.
+class RegionSleep
+{
+private:
+    unsigned int n_regions;
+    std::vector<unsigned int> region_of;     // region of each point
+    std::vector<unsigned int> point_offsets; // points of region r: points[point_offsets[r] .. point_offsets[r + 1])
+    std::vector<unsigned int> points;
+    std::vector<unsigned int> neighbor_offsets; // regions sharing a spring with r, same layout
+    std::vector<unsigned int> neighbors;
+    std::vector<float> region_masses;
+
+    // state
+    std::vector<float> speeds;            // RMS speed of each region over the last time step
+    std::vector<unsigned int> quiet;      // time steps each region has been below sleep_speed
+    std::vector<unsigned char> asleep;    // per region
+    std::vector<unsigned char> point_awake;
+    std::vector<unsigned char> spring_awake;
+    unsigned int n_asleep;
+    bool springs_dirty;                   // spring_awake needs an update
+    unsigned long spring_version;         // counts spring_awake updates
+
+    const mass_spring_system *system;
+    float sleep_speed;
+    unsigned int quiet_steps;
+
+    void setAsleep(unsigned int r, bool sleep);
+    void updateSprings(); // spring_awake from point_awake
+
+public:
+    RegionSleep(const mass_spring_system *system, float sleep_speed, unsigned int quiet_steps,
+                unsigned int region_width = 8);
+
+    // region states from the time step that moved q_prev to q, 3 floats per point
+    void update(const float *q, const float *q_prev);
+
+    void wakePoint(unsigned int i);
+    void wakeAll();
+
+    const unsigned char *pointMask() const;  // 1 per awake point
+    const unsigned char *springMask() const; // 1 per awake spring
+    unsigned long springVersion() const;     // changes whenever springMask() does
+    bool allAsleep() const;
+
+    unsigned int regionCount() const;
+    unsigned int sleepingRegions() const;
+};
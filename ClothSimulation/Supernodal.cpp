@@ -0,0 +1,658 @@
+#include "Supernodal.h"
+#include "Parallel.h"
+#include <Eigen/Dense>
+#include <Eigen/OrderingMethods>
+#include <algorithm>
+#include <stdexcept>
+
+// nested dissection stops at blocks of at most this many points
+static const unsigned int g_leaf_points = 16;
+
+// subtrees with less work are factored by a single task
+static const double g_task_flops = 4e6;
+
+// the triangular solves run subtrees with at most 1 / g_solve_subtrees of the
+// factor whole, and split levels of fewer than g_stream_nodes supernodes
+// above them by coordinates
+static const unsigned int g_solve_subtrees = 128;
+static const unsigned int g_stream_nodes = 16;
+
+// relaxed amalgamation: a child is merged into its parent if the merged
+// supernode is at most g_relax_width[i] columns wide and less than
+// g_relax_zeros[i] of its entries are explicit zeros, for some i
+static const unsigned int g_relax_width[4] = {4, 16, 48, ~0u};
+static const double g_relax_zeros[4] = {1.0, 0.8, 0.1, 0.05};
+
+// entries of a supernode's columns, w columns of a lower trapezoid h rows high
+static double trapezoid(double w, double h) { return w * h - w * (w - 1) / 2; }
+
+// nested dissection of grid rows [r0, r1) and columns [c0, c1), appended to order
+static void dissect(unsigned int n, unsigned int r0, unsigned int r1, unsigned int c0, unsigned int c1,
+                    std::vector<int> &order)
+{
+    const unsigned int height = r1 - r0, width = c1 - c0;
+    if (height * width <= g_leaf_points)
+    {
+        for (unsigned int r = r0; r < r1; r++)
+        {
+            for (unsigned int c = c0; c < c1; c++)
+                order.push_back(n * r + c);
+        }
+        return;
+    }
+
+    // separator across the longer side, on an even line so no bending spring
+    // crosses it; the longer side has at least 9 lines here
+    if (height >= width)
+    {
+        unsigned int m = r0 + height / 2;
+        m += m % 2;
+        dissect(n, r0, m, c0, c1, order);
+        dissect(n, m + 1, r1, c0, c1, order);
+        for (unsigned int c = c0; c < c1; c++)
+            order.push_back(n * m + c);
+    }
+    else
+    {
+        unsigned int m = c0 + width / 2;
+        m += m % 2;
+        dissect(n, r0, r1, c0, m, order);
+        dissect(n, r0, r1, m + 1, c1, order);
+        for (unsigned int r = r0; r < r1; r++)
+            order.push_back(n * r + m);
+    }
+}
+
+SupernodalCholeskySolver::SupernodalCholeskySolver(unsigned int grid_n) : grid_n(grid_n), n(0) {}
+
+void SupernodalCholeskySolver::order(const SparseMatrix &A)
+{
+    perm.clear();
+    if (grid_n > 0)
+    {
+        if ((size_t)grid_n * grid_n != n)
+            throw std::runtime_error("Supernodal system matrix doesn't match the grid");
+        perm.reserve(n);
+        dissect(grid_n, 0, grid_n, 0, grid_n, perm);
+    }
+    else
+    {
+        Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> P;
+        Eigen::AMDOrdering<int>()(A, P);
+        perm.assign(P.indices().data(), P.indices().data() + n);
+    }
+    iperm.resize(n);
+    for (unsigned int k = 0; k < n; k++)
+        iperm[perm[k]] = k;
+}
+
+void SupernodalCholeskySolver::analyze(const SparseMatrix &A)
+{
+    // elimination tree of the ordered matrix, with path compression
+    std::vector<int> etree(n, -1), ancestor(n, -1);
+    for (unsigned int k = 0; k < n; k++)
+    {
+        for (SparseMatrix::InnerIterator it(A, perm[k]); it; ++it)
+        {
+            int next;
+            for (int i = iperm[it.row()]; i != -1 && i < (int)k; i = next)
+            {
+                next = ancestor[i];
+                ancestor[i] = k;
+                if (next == -1)
+                    etree[i] = k;
+            }
+        }
+    }
+
+    // postorder the tree so every subtree is a contiguous range of columns
+    std::vector<int> head(n, -1), next(n, -1), post, stack;
+    post.reserve(n);
+    for (unsigned int j = n; j-- > 0;)
+    {
+        if (etree[j] != -1)
+        {
+            next[j] = head[etree[j]];
+            head[etree[j]] = j;
+        }
+    }
+    for (unsigned int j = 0; j < n; j++)
+    {
+        if (etree[j] != -1)
+            continue;
+        stack.push_back(j);
+        while (!stack.empty())
+        {
+            const int p = stack.back();
+            const int c = head[p];
+            if (c == -1)
+            {
+                stack.pop_back();
+                post.push_back(p);
+            }
+            else
+            {
+                head[p] = next[c];
+                stack.push_back(c);
+            }
+        }
+    }
+    std::vector<int> ipost(n), tree(n);
+    for (unsigned int k = 0; k < n; k++)
+        ipost[post[k]] = k;
+    for (unsigned int k = 0; k < n; k++)
+    {
+        tree[k] = etree[post[k]] == -1 ? -1 : ipost[etree[post[k]]];
+        post[k] = perm[post[k]];
+    }
+    perm.swap(post);
+    for (unsigned int k = 0; k < n; k++)
+        iperm[perm[k]] = k;
+
+    // column counts of L, row i of L is the union of the tree paths from the
+    // columns of row i of A up to i
+    std::vector<unsigned int> counts(n, 1), n_children(n, 0);
+    std::vector<int> mark(n, -1);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        mark[i] = i;
+        for (SparseMatrix::InnerIterator it(A, perm[i]); it; ++it)
+        {
+            for (int k = iperm[it.row()]; k < (int)i && mark[k] != (int)i; k = tree[k])
+            {
+                mark[k] = i;
+                counts[k]++;
+            }
+        }
+        if (tree[i] != -1)
+            n_children[tree[i]]++;
+    }
+
+    // fundamental supernodes, chains of columns with nested structure, merged
+    // into their parents while the explicit zeros stay few
+    struct Group
+    {
+        unsigned int first, width, height;
+        double zeros;
+    };
+    std::vector<Group> groups;
+    for (unsigned int j = 0; j < n;)
+    {
+        Group g = {j, 1, counts[j], 0.0};
+        while (j + g.width < n && tree[j + g.width - 1] == (int)(j + g.width) &&
+               counts[j + g.width] + 1 == counts[j + g.width - 1] && n_children[j + g.width] == 1)
+            g.width++;
+        j += g.width;
+
+        // the group before g ends right before g; it is a child if its last column's parent is in g
+        while (!groups.empty())
+        {
+            const Group &c = groups.back();
+            const int p = tree[c.first + c.width - 1];
+            if (p < (int)g.first || p >= (int)(g.first + g.width))
+                break;
+            const double width = c.width + g.width, height = c.width + g.height;
+            const double entries = trapezoid(width, height);
+            const double zeros = c.zeros + g.zeros + entries - trapezoid(c.width, c.height) -
+                                 trapezoid(g.width, g.height);
+            bool merge = false;
+            for (unsigned int r = 0; r < 4 && !merge; r++)
+                merge = width <= g_relax_width[r] && zeros < g_relax_zeros[r] * entries;
+            if (!merge)
+                break;
+            g = {c.first, c.width + g.width, c.width + g.height, zeros};
+            groups.pop_back();
+        }
+        groups.push_back(g);
+    }
+
+    // supernode tree
+    const unsigned int n_supernodes = groups.size();
+    std::vector<unsigned int> column_node(n);
+    first.resize(n_supernodes + 1);
+    for (unsigned int s = 0; s < n_supernodes; s++)
+    {
+        first[s] = groups[s].first;
+        for (unsigned int j = 0; j < groups[s].width; j++)
+            column_node[groups[s].first + j] = s;
+    }
+    first[n_supernodes] = n;
+    parent.assign(n_supernodes, -1);
+    child_offsets.assign(n_supernodes + 1, 0);
+    for (unsigned int s = 0; s < n_supernodes; s++)
+    {
+        const int p = tree[first[s + 1] - 1];
+        if (p != -1)
+        {
+            parent[s] = column_node[p];
+            child_offsets[parent[s] + 1]++;
+        }
+    }
+    for (unsigned int s = 0; s < n_supernodes; s++)
+        child_offsets[s + 1] += child_offsets[s];
+    children.resize(child_offsets[n_supernodes]);
+    std::vector<unsigned int> fill(child_offsets.begin(), child_offsets.end() - 1);
+    for (unsigned int s = 0; s < n_supernodes; s++)
+    {
+        if (parent[s] != -1)
+            children[fill[parent[s]]++] = s;
+    }
+
+    // row structure, the supernode's columns, then the rows of its columns in
+    // A and of its children below them; children come first in postorder
+    row_offsets.assign(n_supernodes + 1, 0);
+    rows.clear();
+    std::fill(mark.begin(), mark.end(), -1);
+    for (unsigned int s = 0; s < n_supernodes; s++)
+    {
+        const unsigned int f = first[s], l = first[s + 1];
+        for (unsigned int j = f; j < l; j++)
+            rows.push_back(j);
+        const size_t below = rows.size();
+        for (unsigned int j = f; j < l; j++)
+        {
+            for (SparseMatrix::InnerIterator it(A, perm[j]); it; ++it)
+            {
+                const int i = iperm[it.row()];
+                if (i >= (int)l && mark[i] != (int)s)
+                {
+                    mark[i] = s;
+                    rows.push_back(i);
+                }
+            }
+        }
+        for (unsigned int k = child_offsets[s]; k < child_offsets[s + 1]; k++)
+        {
+            const unsigned int c = children[k];
+            for (size_t t = row_offsets[c] + (first[c + 1] - first[c]); t < row_offsets[c + 1]; t++)
+            {
+                const unsigned int i = rows[t];
+                if (i >= l && mark[i] != (int)s)
+                {
+                    mark[i] = s;
+                    rows.push_back(i);
+                }
+            }
+        }
+        std::sort(rows.begin() + below, rows.end());
+        row_offsets[s + 1] = rows.size();
+    }
+
+    // positions of each supernode's rows below its columns in its parent's
+    // rows, both lists are increasing
+    relative.assign(rows.size(), 0);
+    for (unsigned int s = 0; s < n_supernodes; s++)
+    {
+        if (parent[s] == -1)
+            continue;
+        const size_t p_begin = row_offsets[parent[s]];
+        size_t t = p_begin;
+        for (size_t r = row_offsets[s] + (first[s + 1] - first[s]); r < row_offsets[s + 1]; r++)
+        {
+            while (rows[t] != rows[r])
+                t++;
+            relative[r] = t - p_begin;
+        }
+    }
+
+    // storage and work, subtrees
+    value_offsets.resize(n_supernodes + 1);
+    value_offsets[0] = 0;
+    subtree_first.resize(n_supernodes);
+    subtree_flops.assign(n_supernodes, 0.0);
+    std::vector<size_t> subtree_values(n_supernodes);
+    for (unsigned int s = 0; s < n_supernodes; s++)
+    {
+        const double w = first[s + 1] - first[s], h = row_offsets[s + 1] - row_offsets[s];
+        value_offsets[s + 1] = value_offsets[s] + (size_t)(w * h);
+        subtree_first[s] = s;
+        subtree_flops[s] += w * w * w / 3 + (h - w) * w * w + (h - w) * (h - w) * w;
+        subtree_values[s] += (size_t)(w * h);
+    }
+    for (unsigned int s = 0; s < n_supernodes; s++)
+    {
+        if (parent[s] != -1)
+        {
+            subtree_first[parent[s]] = std::min(subtree_first[parent[s]], subtree_first[s]);
+            subtree_flops[parent[s]] += subtree_flops[s];
+            subtree_values[parent[s]] += subtree_values[s];
+        }
+    }
+
+    // solve schedule: the largest subtrees with at most 1 / g_solve_subtrees
+    // of the factor each are solved whole, the supernodes above them by
+    // levels, a supernode's level is one above its highest child's
+    const size_t limit = std::max<size_t>(value_offsets.back() / g_solve_subtrees, 1);
+    std::vector<unsigned int> level(n_supernodes, 0);
+    unsigned int n_levels = 0;
+    subtree_roots.clear();
+    for (unsigned int s = 0; s < n_supernodes; s++)
+    {
+        const int p = parent[s];
+        if (subtree_values[s] <= limit)
+        {
+            if (p == -1 || subtree_values[p] > limit)
+                subtree_roots.push_back(s);
+            continue;
+        }
+        n_levels = std::max(n_levels, level[s] + 1);
+        if (p != -1)
+            level[p] = std::max(level[p], level[s] + 1);
+    }
+    level_offsets.assign(n_levels + 1, 0);
+    for (unsigned int s = 0; s < n_supernodes; s++)
+    {
+        if (subtree_values[s] > limit)
+            level_offsets[level[s] + 1]++;
+    }
+    for (unsigned int k = 0; k < n_levels; k++)
+        level_offsets[k + 1] += level_offsets[k];
+    level_nodes.resize(level_offsets[n_levels]);
+    std::vector<unsigned int> next_node(level_offsets.begin(), level_offsets.end() - 1);
+    for (unsigned int s = 0; s < n_supernodes; s++)
+    {
+        if (subtree_values[s] > limit)
+            level_nodes[next_node[level[s]]++] = s;
+    }
+}
+
+bool SupernodalCholeskySolver::factorNode(const SparseMatrix &A, unsigned int s)
+{
+    const unsigned int f = first[s], w = first[s + 1] - f;
+    const unsigned int h = row_offsets[s + 1] - row_offsets[s], m = h - w;
+    const unsigned int *node_rows = &rows[row_offsets[s]];
+    Eigen::Map<Eigen::MatrixXf> front(&values[value_offsets[s]], h, w);
+    front.setZero();
+    updates[s].assign((size_t)m * m, 0.0f);
+    Eigen::Map<Eigen::MatrixXf> update(updates[s].data(), m, m);
+
+    // assemble the lower triangle of A in the supernode's columns
+    for (unsigned int j = 0; j < w; j++)
+    {
+        for (SparseMatrix::InnerIterator it(A, perm[f + j]); it; ++it)
+        {
+            const unsigned int i = iperm[it.row()];
+            if (i >= f + j)
+                front(std::lower_bound(node_rows, node_rows + h, i) - node_rows, j) += it.value();
+        }
+    }
+
+    // extend-add the children's update matrices, then release them
+    for (unsigned int k = child_offsets[s]; k < child_offsets[s + 1]; k++)
+    {
+        const unsigned int c = children[k];
+        const unsigned int wc = first[c + 1] - first[c];
+        const unsigned int mc = row_offsets[c + 1] - row_offsets[c] - wc;
+        const unsigned int *rel = &relative[row_offsets[c] + wc];
+        const float *uc = updates[c].data();
+        for (unsigned int jj = 0; jj < mc; jj++)
+        {
+            const unsigned int j = rel[jj];
+            if (j < w)
+            {
+                for (unsigned int ii = jj; ii < mc; ii++)
+                    front(rel[ii], j) += uc[(size_t)jj * mc + ii];
+            }
+            else
+            {
+                for (unsigned int ii = jj; ii < mc; ii++)
+                    update(rel[ii] - w, j - w) += uc[(size_t)jj * mc + ii];
+            }
+        }
+        std::vector<float>().swap(updates[c]);
+    }
+
+    // dense partial factorization: L11 L11^T = F11, L21 = F21 L11^-T,
+    // update = F22 - L21 L21^T
+    Eigen::Ref<Eigen::MatrixXf> pivot = front.topRows(w);
+    Eigen::LLT<Eigen::Ref<Eigen::MatrixXf>> llt(pivot);
+    if (llt.info() != Eigen::Success)
+        return false;
+    if (m > 0)
+    {
+        Eigen::Ref<Eigen::MatrixXf> below = front.bottomRows(m);
+        pivot.triangularView<Eigen::Lower>().transpose().solveInPlace<Eigen::OnTheRight>(below);
+        update.selfadjointView<Eigen::Lower>().rankUpdate(below, -1.0f);
+    }
+    return true;
+}
+
+bool SupernodalCholeskySolver::factorTree(const SparseMatrix *A, unsigned int s)
+{
+    bool ok = true;
+    if (subtree_flops[s] < g_task_flops)
+    {
+        for (unsigned int t = subtree_first[s]; t <= s && ok; t++)
+            ok = factorNode(*A, t);
+        return ok;
+    }
+    for (unsigned int k = child_offsets[s]; k < child_offsets[s + 1]; k++)
+    {
+        const unsigned int c = children[k];
+#pragma omp task shared(ok) firstprivate(A, c)
+        if (!factorTree(A, c))
+        {
+#pragma omp atomic write
+            ok = false;
+        }
+    }
+#pragma omp taskwait
+    return ok && factorNode(*A, s);
+}
+
+void SupernodalCholeskySolver::factor(const SparseMatrix &A)
+{
+    n = A.rows();
+    order(A);
+    analyze(A);
+    values.assign(value_offsets.back(), 0.0f);
+    updates.assign(first.size() - 1, std::vector<float>());
+    work.resize(3 * (size_t)n);
+    below.resize(3 * (rows.size() - n));
+
+    // independent subtrees are factored as tasks
+    const SparseMatrix *matrix = &A;
+    bool ok = true;
+#pragma omp parallel
+#pragma omp single
+    for (unsigned int s = 0; s + 1 < first.size(); s++)
+    {
+        if (parent[s] != -1)
+            continue;
+#pragma omp task shared(ok) firstprivate(s)
+        if (!factorTree(matrix, s))
+        {
+#pragma omp atomic write
+            ok = false;
+        }
+    }
+    updates.clear();
+    if (!ok)
+        throw std::runtime_error("System matrix is not positive definite");
+}
+
+void SupernodalCholeskySolver::forwardNode(unsigned int s, unsigned int c0, unsigned int c1)
+{
+    const unsigned int f = first[s], w = first[s + 1] - f;
+    const unsigned int h = row_offsets[s + 1] - row_offsets[s], m = h - w;
+    const size_t plane = below.size() / 3;
+    const float *l = &values[value_offsets[s]];
+
+    // right hand side of the columns less the children's updates, and the
+    // updates of the rows below from the children
+    for (unsigned int c = c0; c < c1; c++)
+    {
+        float *ys = &work[c * n + f], *gs = &below[c * plane + row_offsets[s] - f];
+        std::fill(gs, gs + m, 0.0f);
+        for (unsigned int k = child_offsets[s]; k < child_offsets[s + 1]; k++)
+        {
+            const unsigned int ch = children[k];
+            const unsigned int wc = first[ch + 1] - first[ch];
+            const unsigned int mc = row_offsets[ch + 1] - row_offsets[ch] - wc;
+            const unsigned int *rel = &relative[row_offsets[ch] + wc];
+            const float *gc = &below[c * plane + row_offsets[ch] - first[ch]];
+            for (unsigned int i = 0; i < mc; i++)
+            {
+                if (rel[i] < w)
+                    ys[rel[i]] -= gc[i];
+                else
+                    gs[rel[i] - w] += gc[i];
+            }
+        }
+    }
+
+    // solve with the pivot block and add the block below times the solution
+    // to the updates, column by column so a column is read once for all
+    // coordinates
+    for (unsigned int j = 0; j < w; j++)
+    {
+        const float *lj = l + (size_t)j * h, *lb = lj + w;
+        for (unsigned int c = c0; c < c1; c++)
+        {
+            float *ys = &work[c * n + f], *gs = &below[c * plane + row_offsets[s] - f];
+            const float v = ys[j] /= lj[j];
+            for (unsigned int i = j + 1; i < w; i++)
+                ys[i] -= lj[i] * v;
+#pragma omp simd
+            for (unsigned int i = 0; i < m; i++)
+                gs[i] += lb[i] * v;
+        }
+    }
+}
+
+void SupernodalCholeskySolver::backwardNode(unsigned int s, unsigned int c0, unsigned int c1)
+{
+    const unsigned int f = first[s], w = first[s + 1] - f;
+    const unsigned int h = row_offsets[s + 1] - row_offsets[s], m = h - w;
+    const size_t plane = below.size() / 3;
+    const float *l = &values[value_offsets[s]];
+    const unsigned int *node_rows = &rows[row_offsets[s] + w];
+
+    // solved rows below, they belong to ancestors
+    for (unsigned int c = c0; c < c1; c++)
+    {
+        const float *y = &work[c * n];
+        float *gs = &below[c * plane + row_offsets[s] - f];
+        for (unsigned int i = 0; i < m; i++)
+            gs[i] = y[node_rows[i]];
+    }
+
+    for (unsigned int j = w; j-- > 0;)
+    {
+        const float *lj = l + (size_t)j * h, *lb = lj + w;
+        for (unsigned int c = c0; c < c1; c++)
+        {
+            float *ys = &work[c * n + f];
+            const float *gs = &below[c * plane + row_offsets[s] - f];
+            float sum = 0.0f;
+            for (unsigned int i = j + 1; i < w; i++)
+                sum += lj[i] * ys[i];
+#pragma omp simd reduction(+ : sum)
+            for (unsigned int i = 0; i < m; i++)
+                sum += lb[i] * gs[i];
+            ys[j] = (ys[j] - sum) / lj[j];
+        }
+    }
+}
+
+void SupernodalCholeskySolver::solve(const float *b, float *x)
+{
+    const int n = this->n;
+    const int n_subtrees = subtree_roots.size(), n_levels = level_offsets.size() - 1;
+    float *y = work.data();
+    if (!parallelEnabled())
+    {
+        // one thread: every supernode in postorder, children before parents
+        const unsigned int n_supernodes = supernodeCount();
+        for (int k = 0; k < n; k++)
+        {
+            y[k] = b[3 * perm[k]];
+            y[n + k] = b[3 * perm[k] + 1];
+            y[2 * n + k] = b[3 * perm[k] + 2];
+        }
+        for (unsigned int s = 0; s < n_supernodes; s++)
+            forwardNode(s, 0, 3);
+        for (unsigned int s = n_supernodes; s-- > 0;)
+            backwardNode(s, 0, 3);
+        for (int k = 0; k < n; k++)
+        {
+            x[3 * perm[k]] = y[k];
+            x[3 * perm[k] + 1] = y[n + k];
+            x[3 * perm[k] + 2] = y[2 * n + k];
+        }
+        return;
+    }
+
+#pragma omp parallel
+    {
+        // one plane per coordinate, in elimination order
+#pragma omp for schedule(static)
+        for (int k = 0; k < n; k++)
+        {
+            y[k] = b[3 * perm[k]];
+            y[n + k] = b[3 * perm[k] + 1];
+            y[2 * n + k] = b[3 * perm[k] + 2];
+        }
+
+        // L y = P b: subtrees in postorder, then the levels above them
+        // bottom up; levels with few supernodes solve each coordinate as a
+        // separate stream
+#pragma omp for schedule(dynamic)
+        for (int t = 0; t < n_subtrees; t++)
+        {
+            for (unsigned int s = subtree_first[subtree_roots[t]]; s <= subtree_roots[t]; s++)
+                forwardNode(s, 0, 3);
+        }
+        for (int k = 0; k < n_levels; k++)
+        {
+            const int begin = level_offsets[k], count = level_offsets[k + 1] - begin;
+            if (count < (int)g_stream_nodes)
+            {
+#pragma omp for schedule(dynamic)
+                for (int t = 0; t < 3 * count; t++)
+                    forwardNode(level_nodes[begin + t / 3], t % 3, t % 3 + 1);
+            }
+            else
+            {
+#pragma omp for schedule(dynamic)
+                for (int t = 0; t < count; t++)
+                    forwardNode(level_nodes[begin + t], 0, 3);
+            }
+        }
+
+        // L^T x = y, top down: the levels, then the subtrees in reverse postorder
+        for (int k = n_levels; k-- > 0;)
+        {
+            const int begin = level_offsets[k], count = level_offsets[k + 1] - begin;
+            if (count < (int)g_stream_nodes)
+            {
+#pragma omp for schedule(dynamic)
+                for (int t = 0; t < 3 * count; t++)
+                    backwardNode(level_nodes[begin + t / 3], t % 3, t % 3 + 1);
+            }
+            else
+            {
+#pragma omp for schedule(dynamic)
+                for (int t = 0; t < count; t++)
+                    backwardNode(level_nodes[begin + t], 0, 3);
+            }
+        }
+#pragma omp for schedule(dynamic)
+        for (int t = 0; t < n_subtrees; t++)
+        {
+            for (unsigned int s = subtree_roots[t] + 1; s-- > subtree_first[subtree_roots[t]];)
+                backwardNode(s, 0, 3);
+        }
+
+#pragma omp for schedule(static)
+        for (int k = 0; k < n; k++)
+        {
+            x[3 * perm[k]] = y[k];
+            x[3 * perm[k] + 1] = y[n + k];
+            x[3 * perm[k] + 2] = y[2 * n + k];
+        }
+    }
+}
+
+unsigned int SupernodalCholeskySolver::supernodeCount() const { return first.size() - 1; }
+size_t SupernodalCholeskySolver::factorSize() const { return values.size(); }
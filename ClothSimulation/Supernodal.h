@@ -0,0 +1,78 @@
+#pragma once
+#include <Eigen/Sparse>
+#include <vector>
+
+#include "LinearSolver.h"
+
+// Supernodal multifrontal Cholesky
+//
+// Grid systems are ordered by nested dissection: the grid is split in halves
+// along its longer side by a separator row or column, recursively, and each
+// separator is numbered after both halves. Separators sit on even rows and
+// columns, which bending springs never cross. Other systems use Eigen's AMD
+// ordering. Columns of the elimination tree with nested structure are grouped
+// into supernodes, small ones are merged into their parents when the explicit
+// zeros stay few. Each supernode assembles a dense frontal matrix from A and
+// the update matrices of its children and factors it with Eigen's blocked
+// dense kernels: Cholesky of the pivot block, a triangular solve for the rows
+// below and a rank update for the parent. Independent subtrees are factored
+// as OpenMP tasks. The factor is stored by supernodes, dense column-major
+// blocks of rows x width with one row index list per supernode.
+//
+// The triangular solves walk the same tree. The forward solve passes each
+// supernode's updates of the rows below it up to its parent, which adds them
+// in through the relative row positions like the update matrices, so a
+// supernode only writes its own columns and update vector and every solve
+// order that finishes children first is race free; the backward solve reads
+// the solved rows below and writes only its columns. Small subtrees are
+// solved whole by one thread each, the supernodes above them level by level,
+// and where a level has too few supernodes to go round the x, y and z
+// coordinates are solved as three independent streams. Coordinates are
+// stored as separate planes, and solves do not allocate.
+class SupernodalCholeskySolver : public LinearSolver
+{
+private:
+    unsigned int grid_n; // grid width for nested dissection, 0 for AMD
+    unsigned int n;      // unknowns per coordinate, one per point
+
+    std::vector<int> perm;  // elimination order, perm[k] is the point eliminated k-th
+    std::vector<int> iperm; // inverse of perm
+
+    // supernode s has columns first[s] .. first[s + 1] - 1 and rows
+    // rows[row_offsets[s] .. row_offsets[s + 1]), its own columns first,
+    // and stores its factor columns at values[value_offsets[s]]
+    std::vector<unsigned int> first;
+    std::vector<int> parent;                    // -1 for roots
+    std::vector<unsigned int> child_offsets;    // children of s: children[child_offsets[s] .. child_offsets[s + 1])
+    std::vector<unsigned int> children;
+    std::vector<unsigned int> subtree_first;    // first supernode of the subtree of s, subtrees are contiguous
+    std::vector<double> subtree_flops;          // factorization work of the subtree of s
+    std::vector<unsigned int> subtree_roots;    // subtrees solved whole
+    std::vector<unsigned int> level_offsets;    // supernodes above them by level:
+    std::vector<unsigned int> level_nodes;      // level_nodes[level_offsets[k] .. level_offsets[k + 1])
+    std::vector<size_t> row_offsets;
+    std::vector<unsigned int> rows;
+    std::vector<unsigned int> relative;         // position of each row below the columns in the parent's rows
+    std::vector<size_t> value_offsets;
+    std::vector<float> values;
+
+    std::vector<std::vector<float>> updates;    // update matrices of factored supernodes, until assembled
+    std::vector<float> work;                    // solution planes by coordinate, 3 * n
+    std::vector<float> below;                   // update vector of the rows below each supernode, 3 planes
+
+    void order(const SparseMatrix &A);
+    void analyze(const SparseMatrix &A);
+    bool factorNode(const SparseMatrix &A, unsigned int s);
+    bool factorTree(const SparseMatrix *A, unsigned int s); // tasks for large subtrees
+    void forwardNode(unsigned int s, unsigned int c0, unsigned int c1);  // coordinates c0 .. c1 - 1
+    void backwardNode(unsigned int s, unsigned int c0, unsigned int c1);
+
+public:
+    SupernodalCholeskySolver(unsigned int grid_n);
+
+    virtual void factor(const SparseMatrix &A);
+    virtual void solve(const float *b, float *x);
+
+    unsigned int supernodeCount() const;
+    size_t factorSize() const; // stored factor entries, explicit zeros included
+};
@@ -0,0 +1,27 @@
+#include "Timestep.h"
+#include <cassert>
+
+FixedTimestep::FixedTimestep(float step, unsigned int max_steps)
+    : step(step), max_steps(max_steps), accumulator(0), dropped(0)
+{
+    assert(step > 0 && max_steps > 0);
+}
+
+unsigned int FixedTimestep::advance(float elapsed)
+{
+    accumulator += elapsed;
+    unsigned int n = (unsigned int)(accumulator / step);
+    if (n > max_steps)
+    {
+        // spiral-of-death guard: keep the remainder, drop whole steps
+        dropped += n - max_steps;
+        accumulator -= (n - max_steps) * step;
+        n = max_steps;
+    }
+    accumulator -= n * step;
+    return n;
+}
+
+void FixedTimestep::reset() { accumulator = 0; }
+
+unsigned long FixedTimestep::droppedSteps() const { return dropped; }
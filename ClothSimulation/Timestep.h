@@ -0,0 +1,24 @@
+#pragma once
+
+// Fixed-timestep scheduler
+//
+// Real elapsed time is collected in an accumulator and spent in whole time
+// steps, so simulated time follows wall-clock time regardless of frame rate.
+// At most max_steps are run per advance; time beyond that is dropped so a
+// slow frame can't schedule ever more work (spiral of death).
+class FixedTimestep
+{
+private:
+    float step;             // simulated seconds per time step
+    unsigned int max_steps; // most time steps per advance
+    float accumulator;      // real time not yet simulated
+    unsigned long dropped;  // time steps dropped by the guard
+
+public:
+    FixedTimestep(float step, unsigned int max_steps);
+
+    unsigned int advance(float elapsed); // add elapsed seconds, returns number of time steps to run
+    void reset();                        // drop accumulated time
+
+    unsigned long droppedSteps() const;
+};
@@ -1,64 +1,54 @@
 #include "UserInteraction.h"
-// #include <GL/glew.h>
-#include <glad/glad.h>
-#include <iostream>
-#include <cmath>
+#include <glm/glm.hpp>
 
-UserInteraction::UserInteraction(Renderer *renderer, CgPointFixNode *fixer, float *vbuff)
-    : renderer(renderer), vbuff(vbuff), fixer(fixer), i(-1) {}
+UserInteraction::UserInteraction(CgRegionFixNode *grabber, float *vbuff, const unsigned int *ibuff, unsigned int ibuffLen)
+    : i(-1), grabber(grabber), radius(0.0f), bvh(ibuff, ibuffLen, vbuff), width(1), height(1) {}
 
-void UserInteraction::setModelview(const glm::mat4 &mv) { renderer->setModelview(mv); }
-void UserInteraction::setProjection(const glm::mat4 &p) { renderer->setProjection(p); }
+void UserInteraction::setModelview(const glm::mat4 &mv) { modelview = mv; }
+void UserInteraction::setProjection(const glm::mat4 &p) { projection = p; }
+void UserInteraction::setViewport(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+}
+void UserInteraction::setRadius(float radius) { this->radius = radius; }
 
-void UserInteraction::grabPoint(int mouse_x, int mouse_y)
+int UserInteraction::pickPoint(int mouse_x, int mouse_y, const float *positions, unsigned int stride)
 {
-    // render scene
-    glClearColor(0, 0, 0, 0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glDisable(GL_FRAMEBUFFER_SRGB);
-    renderer->draw();
-    glFlush();
+    // mouse ray from the near to the far plane, mouse y points down
+    glm::mat4 inv = glm::inverse(projection * modelview);
+    float x = 2.0f * (mouse_x + 0.5f) / width - 1.0f;
+    float y = 1.0f - 2.0f * (mouse_y + 0.5f) / height;
+    glm::vec4 near_point = inv * glm::vec4(x, y, -1.0f, 1.0f);
+    glm::vec4 far_point = inv * glm::vec4(x, y, 1.0f, 1.0f);
+    vec3 origin = vec3(near_point) / near_point.w;
+    vec3 dir = vec3(far_point) / far_point.w - origin;
+
+    // nearest triangle under the displayed positions
+    bvh.refit(positions, stride);
+    TriangleBvh::Hit hit;
+    if (!bvh.intersect(&origin[0], &dir[0], hit))
+        return -1;
+    return (int)bvh.nearestVertex(hit);
+}
 
-    // read color
-    color c(3);
-    glReadPixels(mouse_x, mouse_y, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, &c[0]);
-    i = colorToIndex(c);
+void UserInteraction::grabPoint(int i)
+{
+    this->i = i;
     if (i != -1)
-        fixer->fixPoint(i);
-
-    // return to normal state
-    glClearColor(0.25f, 0.25f, 0.25f, 0);
-    glEnable(GL_FRAMEBUFFER_SRGB);
+        grabber->grab(i, radius);
 }
 
 void UserInteraction::releasePoint()
 {
     if (i == -1)
         return;
-    fixer->releasePoint(i);
+    grabber->release();
     i = -1;
 }
 void UserInteraction::movePoint(vec3 v)
 {
     if (i == -1)
         return;
-    fixer->releasePoint(i);
-    for (int j = 0; j < 3; j++)
-    {
-        vbuff[3 * i + j] += v[j];
-    }
-
-    fixer->fixPoint(i);
+    grabber->move(&v[0]);
 }
-
-GridMeshUI::GridMeshUI(Renderer *renderer, CgPointFixNode *fixer, float *vbuff, unsigned int n)
-    : UserInteraction(renderer, fixer, vbuff), n(n) {}
-
-int GridMeshUI::colorToIndex(color c) const
-{
-    if (c[2] != 51)
-        return -1;
-    int vx = std::round((n - 1) * c[0] / 255.0);
-    int vy = std::round((n - 1) * c[1] / 255.0);
-    return n * vy + vx;
-}
\ No newline at end of file
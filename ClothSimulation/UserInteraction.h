@@ -2,37 +2,31 @@
 #include <glm/common.hpp>
 
 #include "MassSpringSolver.h"
-#include "Renderer.h"
+#include "Bvh.h"
 
 class UserInteraction
 {
 protected:
     typedef glm::vec3 vec3;
-    typedef std::vector<unsigned char> color;
 
-    int i;                 // index of fixed point
-    float *vbuff;          // vertex buffer
-    CgPointFixNode *fixer; // point fixer
-    Renderer *renderer;    // pick shader renderer
-    virtual int colorToIndex(color c) const = 0;
+    int i;                    // index of grabbed point
+    CgRegionFixNode *grabber; // grabbed region
+    float radius;             // grab radius, 0 grabs a single point
+    TriangleBvh bvh;          // picking
+    glm::mat4 modelview, projection;
+    int width, height;     // viewport in mouse coordinates
 
 public:
-    UserInteraction(Renderer *renderer, CgPointFixNode *fixer, float *vbuff);
+    UserInteraction(CgRegionFixNode *grabber, float *vbuff, const unsigned int *ibuff, unsigned int ibuffLen);
 
     void setModelview(const glm::mat4 &mv);
     void setProjection(const glm::mat4 &p);
-
-    void grabPoint(int mouse_x, int mouse_y); // grab point with color c
-    void movePoint(vec3 v);                   // move grabbed point along mouse
-    void releasePoint();                      // release grabbed point;
+    void setViewport(int width, int height);
+    void setRadius(float radius);
+
+    // index of the point under the mouse or -1, positions as displayed with a stride in floats
+    int pickPoint(int mouse_x, int mouse_y, const float *positions, unsigned int stride = 3);
+    void grabPoint(int i);  // grab the region around point i
+    void movePoint(vec3 v); // move grabbed region along mouse
+    void releasePoint();    // release grabbed region
 };
-
-class GridMeshUI : public UserInteraction
-{
-protected:
-    const unsigned int n; // grid width
-    virtual int colorToIndex(color c) const;
-
-public:
-    GridMeshUI(Renderer *renderer, CgPointFixNode *fixer, float *vbuff, unsigned int n);
-};
\ No newline at end of file
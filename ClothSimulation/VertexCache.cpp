@@ -0,0 +1,467 @@
+#include "VertexCache.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char g_magic[8] = {'F', 'M', 'S', 'V', 'C', 'A', 'C', 'H'};
+static const unsigned int g_max_unary = 16; // longer quotients escape to 32 raw bits
+
+// BIT IO
+class BitWriter
+{
+private:
+    VertexCacheCodec::Bytes &out;
+    uint64_t acc;      // pending bits, lsb first
+    unsigned int bits; // number of pending bits
+
+public:
+    BitWriter(VertexCacheCodec::Bytes &out) : out(out), acc(0), bits(0) {}
+
+    void put(uint32_t value, unsigned int n) // n <= 32
+    {
+        acc |= (uint64_t)value << bits;
+        bits += n;
+        while (bits >= 8)
+        {
+            out.push_back((uint8_t)acc);
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    void flush()
+    {
+        if (bits > 0)
+            out.push_back((uint8_t)acc);
+        acc = 0;
+        bits = 0;
+    }
+};
+
+class BitReader
+{
+private:
+    const uint8_t *data, *end;
+    uint64_t acc;
+    unsigned int bits;
+
+    void refill()
+    {
+        while (bits <= 56)
+        {
+            uint64_t byte = data < end ? *data++ : 0;
+            acc |= byte << bits;
+            bits += 8;
+        }
+    }
+
+public:
+    BitReader(const uint8_t *data, size_t size) : data(data), end(data + size), acc(0), bits(0) {}
+
+    uint32_t get(unsigned int n) // n <= 32
+    {
+        if (n == 0)
+            return 0;
+        if (bits < n)
+            refill();
+        uint32_t value = (uint32_t)(acc & ((1ull << n) - 1));
+        acc >>= n;
+        bits -= n;
+        return value;
+    }
+    unsigned int unary(unsigned int limit) // count of 1 bits before a 0, at most limit (<= 32)
+    {
+        if (bits < 33)
+            refill();
+        unsigned int q = ~acc ? (unsigned int)__builtin_ctzll(~acc) : 64;
+        if (q >= limit)
+        {
+            acc >>= limit;
+            bits -= limit;
+            return limit;
+        }
+        acc >>= q + 1;
+        bits -= q + 1;
+        return q;
+    }
+};
+
+static inline uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static inline int32_t unzigzag(uint32_t u) { return (int32_t)(u >> 1) ^ -(int32_t)(u & 1); }
+
+// CODEC
+void VertexCacheCodec::encode(const float *frame, unsigned int n, float quantum, const QuantizedFrame *prev,
+                              QuantizedFrame &quantized, Residuals &residuals, Bytes &out)
+{
+    // quantize
+    quantized.resize(n);
+    const float scale = 1.0f / quantum;
+    for (unsigned int i = 0; i < n; i++)
+        quantized[i] = (int32_t)std::lround(frame[i] * scale);
+
+    // predict, keyframes use the same coordinate of the previous vertex
+    residuals.resize(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        int32_t prediction = prev ? (*prev)[i] : (i >= 3 ? quantized[i - 3] : 0);
+        residuals[i] = zigzag(quantized[i] - prediction);
+    }
+
+    // Rice code each block with its own parameter
+    out.clear();
+    out.reserve(n);
+    BitWriter writer(out);
+    for (unsigned int b = 0; b < n; b += block_size)
+    {
+        unsigned int e = std::min(n, b + block_size);
+        uint64_t sum = 0;
+        for (unsigned int i = b; i < e; i++)
+            sum += residuals[i];
+        uint32_t mean = (uint32_t)(sum / (e - b));
+        unsigned int k = 0;
+        while (k < 31 && (1u << (k + 1)) <= mean)
+            k++;
+        writer.put(k, 5);
+
+        for (unsigned int i = b; i < e; i++)
+        {
+            uint32_t q = residuals[i] >> k;
+            if (q >= g_max_unary)
+            {
+                writer.put((1u << g_max_unary) - 1, g_max_unary);
+                writer.put(residuals[i], 32);
+                continue;
+            }
+            writer.put((1u << q) - 1, q + 1); // q ones then a zero
+            if (k > 0)
+                writer.put(residuals[i] & ((1u << k) - 1), k);
+        }
+    }
+    writer.flush();
+}
+
+void VertexCacheCodec::decode(const uint8_t *data, size_t size, unsigned int n,
+                              const QuantizedFrame *prev, QuantizedFrame &quantized)
+{
+    quantized.resize(n);
+    BitReader reader(data, size);
+    for (unsigned int b = 0; b < n; b += block_size)
+    {
+        unsigned int e = std::min(n, b + block_size);
+        unsigned int k = reader.get(5);
+        for (unsigned int i = b; i < e; i++)
+        {
+            uint32_t residual;
+            unsigned int q = reader.unary(g_max_unary);
+            if (q == g_max_unary)
+                residual = reader.get(32);
+            else
+                residual = (q << k) | reader.get(k);
+
+            int32_t prediction = prev ? (*prev)[i] : (i >= 3 ? quantized[i - 3] : 0);
+            quantized[i] = prediction + unzigzag(residual);
+        }
+    }
+}
+
+void VertexCacheCodec::dequantize(const QuantizedFrame &quantized, float quantum, float *frame)
+{
+    for (size_t i = 0; i < quantized.size(); i++)
+        frame[i] = quantized[i] * quantum;
+}
+
+// RECORDER
+VertexCacheRecorder::VertexCacheRecorder(const char *path, unsigned int n_values, float quantum,
+                                         unsigned int keyframe_interval, unsigned int queue_length)
+    : write_offset(sizeof(VertexCacheHeader)), slots(queue_length, Frame(n_values)),
+      head(0), count(0), closing(false), failed(false), raw_bytes(0), encoded_bytes(0),
+      writer_seconds(0), stall_seconds(0), stalls(0)
+{
+    assert(queue_length > 0 && keyframe_interval > 0);
+    fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error(std::string("Failed to open vertex cache ") + path);
+
+    header = {};
+    std::memcpy(header.magic, g_magic, sizeof(g_magic));
+    header.version = VertexCacheCodec::version;
+    header.n_values = n_values;
+    header.keyframe_interval = keyframe_interval;
+    header.quantum = quantum;
+
+    // header is rewritten on close with the frame count and index offset
+    if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+        throw std::runtime_error("Failed to write vertex cache header.");
+
+    writer = std::thread(&VertexCacheRecorder::run, this);
+}
+
+VertexCacheRecorder::~VertexCacheRecorder() { close(); }
+
+void VertexCacheRecorder::push(const float *frame)
+{
+    // single producer: the slot after the queued ones is not touched by the writer
+    Frame *slot;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (count == slots.size())
+        {
+            // back-pressure: the writer can't keep up, wait for a free slot
+            auto start = std::chrono::steady_clock::now();
+            not_full.wait(lock, [this] { return count < slots.size(); });
+            stall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            stalls++;
+        }
+        slot = &slots[(head + count) % slots.size()];
+    }
+    std::memcpy(slot->data(), frame, sizeof(float) * slot->size());
+
+    std::unique_lock<std::mutex> lock(mutex);
+    count++;
+    not_empty.notify_one();
+}
+
+void VertexCacheRecorder::run()
+{
+    VertexCacheCodec::QuantizedFrame prev, quantized;
+    VertexCacheCodec::Residuals residuals;
+    VertexCacheCodec::Bytes encoded;
+
+    while (true)
+    {
+        // wait for a frame, the slot stays owned by the writer until it is encoded
+        Frame *frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [this] { return count > 0 || closing; });
+            if (count == 0)
+                return;
+            frame = &slots[head];
+        }
+
+        // after a write error frames are dropped so push() never blocks forever
+        if (failed)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            head = (head + 1) % slots.size();
+            count--;
+            not_full.notify_one();
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool keyframe = index.size() % header.keyframe_interval == 0;
+        VertexCacheCodec::encode(frame->data(), header.n_values, header.quantum,
+                                 keyframe ? nullptr : &prev, quantized, residuals, encoded);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            head = (head + 1) % slots.size();
+            count--;
+            not_full.notify_one();
+        }
+        prev.swap(quantized);
+
+        // write
+        size_t written = 0;
+        while (written < encoded.size())
+        {
+            ssize_t n = pwrite(fd, encoded.data() + written, encoded.size() - written, write_offset + written);
+            if (n <= 0)
+                break;
+            written += n;
+        }
+        if (written < encoded.size())
+        {
+            std::cerr << "Vertex cache write failed, recording stopped." << std::endl;
+            failed = true;
+            continue;
+        }
+        index.push_back({write_offset, (uint32_t)encoded.size(), keyframe ? 1u : 0u});
+        write_offset += encoded.size();
+        raw_bytes += sizeof(float) * header.n_values;
+        encoded_bytes += encoded.size();
+        writer_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void VertexCacheRecorder::close()
+{
+    if (fd < 0)
+        return;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        closing = true;
+        not_empty.notify_one();
+    }
+    writer.join();
+
+    // index and final header
+    header.n_frames = (uint32_t)index.size();
+    header.index_offset = write_offset;
+    size_t index_size = sizeof(VertexCacheIndexEntry) * index.size();
+    if (pwrite(fd, index.data(), index_size, write_offset) != (ssize_t)index_size ||
+        pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+        std::cerr << "Failed to finalize vertex cache." << std::endl;
+    ::close(fd);
+    fd = -1;
+}
+
+void VertexCacheRecorder::printStats() const
+{
+    double ratio = encoded_bytes > 0 ? (double)raw_bytes / encoded_bytes : 0.0;
+    double throughput = writer_seconds > 0 ? raw_bytes / writer_seconds / (1 << 20) : 0.0;
+    std::cout << "Vertex cache: " << index.size() << " frames, "
+              << "compression ratio " << ratio << ", "
+              << "writer throughput " << throughput << " MB/s, "
+              << stalls << " stalls (" << stall_seconds * 1000 << " ms)" << std::endl;
+}
+
+// PLAYER
+VertexCachePlayer::VertexCachePlayer(const char *path, unsigned int cache_size, unsigned int readahead)
+    : cache(cache_size), clock(0), readahead(readahead)
+{
+    assert(cache_size > 1);
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error(std::string("Failed to open vertex cache ") + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(VertexCacheHeader))
+    {
+        ::close(fd);
+        throw std::runtime_error("Invalid vertex cache file.");
+    }
+    mapping_size = st.st_size;
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        throw std::runtime_error("Failed to map vertex cache.");
+
+    // frames are read on demand, not in file order
+    madvise(mapping, mapping_size, MADV_RANDOM);
+
+    // validate header and index
+    header = (const VertexCacheHeader *)mapping;
+    index = (const VertexCacheIndexEntry *)((const char *)mapping + header->index_offset);
+    const char *error = nullptr;
+    if (std::memcmp(header->magic, g_magic, sizeof(g_magic)) != 0)
+        error = "Not a vertex cache file.";
+    else if (header->version != VertexCacheCodec::version)
+        error = "Unsupported vertex cache version.";
+    else if (header->n_frames == 0 || header->keyframe_interval == 0)
+        error = "Empty or unfinished vertex cache.";
+    else if (header->index_offset + sizeof(VertexCacheIndexEntry) * (uint64_t)header->n_frames > mapping_size)
+        error = "Truncated vertex cache file.";
+    for (unsigned int i = 0; !error && i < header->n_frames; i++)
+    {
+        if (index[i].offset + index[i].size > header->index_offset ||
+            (index[i].flags != 0) != (i % header->keyframe_interval == 0))
+            error = "Corrupt vertex cache index.";
+    }
+    if (error)
+    {
+        munmap(mapping, mapping_size);
+        throw std::runtime_error(error);
+    }
+
+    for (CachedFrame &c : cache)
+    {
+        c.frame = -1;
+        c.last_use = 0;
+        c.values.resize(header->n_values);
+    }
+}
+
+VertexCachePlayer::~VertexCachePlayer() { munmap(mapping, mapping_size); }
+
+unsigned int VertexCachePlayer::frameCount() const { return header->n_frames; }
+unsigned int VertexCachePlayer::valueCount() const { return header->n_values; }
+
+VertexCachePlayer::CachedFrame *VertexCachePlayer::lookup(unsigned int i)
+{
+    for (CachedFrame &c : cache)
+    {
+        if (c.frame == (int)i)
+            return &c;
+    }
+    return nullptr;
+}
+
+VertexCachePlayer::CachedFrame &VertexCachePlayer::evict(const CachedFrame *keep)
+{
+    CachedFrame *oldest = nullptr;
+    for (CachedFrame &c : cache)
+    {
+        if (&c == keep)
+            continue;
+        if (c.frame == -1)
+            return c;
+        if (!oldest || c.last_use < oldest->last_use)
+            oldest = &c;
+    }
+    return *oldest;
+}
+
+void VertexCachePlayer::prefetch(unsigned int first, unsigned int last)
+{
+    // ask the kernel to page in the encoded frames ahead of playback
+    last = std::min(last, header->n_frames - 1);
+    if (first > last)
+        return;
+    const long page = sysconf(_SC_PAGESIZE);
+    uint64_t begin = index[first].offset / page * page;
+    uint64_t end = index[last].offset + index[last].size;
+    madvise((char *)mapping + begin, end - begin, MADV_WILLNEED);
+}
+
+const float *VertexCachePlayer::frame(unsigned int i)
+{
+    assert(i < header->n_frames);
+    const uint8_t *data = (const uint8_t *)mapping;
+    CachedFrame *hit = lookup(i);
+    if (!hit)
+    {
+        // closest decoded base: the frame keyframe(i)..i - 1 with the highest index
+        unsigned int keyframe = i - i % header->keyframe_interval;
+        const VertexCacheCodec::QuantizedFrame *base = nullptr;
+        const CachedFrame *base_frame = nullptr;
+        unsigned int start = keyframe;
+        for (unsigned int j = i; j-- > keyframe;)
+        {
+            base_frame = lookup(j);
+            if (base_frame)
+            {
+                base = &base_frame->quantized;
+                start = j + 1;
+                break;
+            }
+        }
+        if (!base)
+            prefetch(keyframe, i);
+
+        // decode forward from the base, only frame i is kept in the cache
+        CachedFrame &target = evict(base_frame);
+        target.frame = -1;
+        for (unsigned int j = start; j <= i; j++)
+        {
+            VertexCacheCodec::QuantizedFrame &out = j == i ? target.quantized : scratch[j % 2];
+            VertexCacheCodec::decode(data + index[j].offset, index[j].size, header->n_values,
+                                     j == keyframe ? nullptr : base, out);
+            base = &out;
+        }
+        VertexCacheCodec::dequantize(target.quantized, header->quantum, target.values.data());
+        target.frame = i;
+        hit = &target;
+    }
+    hit->last_use = ++clock;
+
+    prefetch(i + 1, i + readahead);
+    return hit->values.data();
+}
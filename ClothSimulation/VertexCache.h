@@ -0,0 +1,135 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Vertex cache file header
+//
+// A vertex cache stores one vertex buffer per frame. Positions are quantized
+// to integer multiples of quantum, keyframes store the difference to the
+// previous value in the buffer and the remaining frames the difference to the
+// previous frame. Differences are Rice coded in blocks. The frame index
+// (one VertexCacheIndexEntry per frame) is written at index_offset on close.
+struct VertexCacheHeader
+{
+    char magic[8];               // "FMSVCACH"
+    uint32_t version;            // format version
+    uint32_t n_values;           // floats per frame
+    uint32_t keyframe_interval;  // frames between keyframes
+    uint32_t n_frames;           // number of frames, 0 while recording
+    float quantum;               // quantization step
+    uint32_t reserved;
+    uint64_t index_offset;       // offset of the frame index
+};
+
+struct VertexCacheIndexEntry
+{
+    uint64_t offset;  // frame data offset
+    uint32_t size;    // frame data size in bytes
+    uint32_t flags;   // 1 if keyframe
+};
+
+// Vertex cache frame codec
+class VertexCacheCodec
+{
+public:
+    typedef std::vector<int32_t> QuantizedFrame;
+    typedef std::vector<uint8_t> Bytes;
+    typedef std::vector<uint32_t> Residuals;
+
+    static const uint32_t version = 1;
+    static const unsigned int block_size = 32; // values per Rice block
+
+    // quantize, predict from prev (keyframe if null) and entropy code into out;
+    // residuals is scratch, reused across frames like quantized and out
+    static void encode(const float *frame, unsigned int n, float quantum, const QuantizedFrame *prev,
+                       QuantizedFrame &quantized, Residuals &residuals, Bytes &out);
+
+    // decode data into quantized values, prev must be the previous frame unless keyframe
+    static void decode(const uint8_t *data, size_t size, unsigned int n,
+                       const QuantizedFrame *prev, QuantizedFrame &quantized);
+
+    // dequantize
+    static void dequantize(const QuantizedFrame &quantized, float quantum, float *frame);
+};
+
+// Asynchronous vertex cache recorder
+//
+// push() copies a frame into a bounded queue, a writer thread encodes and
+// writes it. Every keyframe_interval-th frame is a keyframe, 10 by default.
+// Playback decodes from the last keyframe when seeking, so the default was
+// lowered from 30 when playback was added, bounding a seek to ten decodes.
+class VertexCacheRecorder
+{
+private:
+    typedef std::vector<float> Frame;
+
+    int fd;                              // cache file
+    VertexCacheHeader header;            // file header
+    std::vector<VertexCacheIndexEntry> index; // frame index
+    uint64_t write_offset;               // end of frame data
+
+    // bounded frame queue
+    std::vector<Frame> slots;            // preallocated frame buffers
+    unsigned int head, count;            // first queued slot, number of queued slots
+    bool closing;
+    bool failed;                         // set by the writer after a write error
+    std::mutex mutex;
+    std::condition_variable not_empty, not_full;
+    std::thread writer;
+
+    // statistics
+    uint64_t raw_bytes, encoded_bytes;   // bytes before / after encoding
+    double writer_seconds;               // time spent encoding and writing
+    double stall_seconds;                // time push() waited for a free slot
+    unsigned int stalls;                 // number of pushes that waited
+
+    void run(); // writer thread
+
+public:
+    VertexCacheRecorder(const char *path, unsigned int n_values, float quantum = 1e-4f,
+                        unsigned int keyframe_interval = 10, unsigned int queue_length = 8);
+    ~VertexCacheRecorder();
+
+    void push(const float *frame); // copy frame into queue, blocks while the queue is full
+    void close();                  // drain queue, write index and header
+
+    void printStats() const;
+};
+
+// Memory-mapped vertex cache player
+class VertexCachePlayer
+{
+private:
+    struct CachedFrame
+    {
+        int frame;                               // frame index, -1 if unused
+        uint64_t last_use;                       // lru stamp
+        VertexCacheCodec::QuantizedFrame quantized;
+        std::vector<float> values;
+    };
+
+    void *mapping;                               // mapped cache file
+    size_t mapping_size;
+    const VertexCacheHeader *header;
+    const VertexCacheIndexEntry *index;
+    std::vector<CachedFrame> cache;              // lru of decoded frames
+    VertexCacheCodec::QuantizedFrame scratch[2]; // intermediate frames of a seek
+    uint64_t clock;                              // lru clock
+    unsigned int readahead;                      // frames prefetched past the current one
+
+    CachedFrame *lookup(unsigned int i);
+    CachedFrame &evict(const CachedFrame *keep); // least recently used entry other than keep
+    void prefetch(unsigned int first, unsigned int last);
+
+public:
+    VertexCachePlayer(const char *path, unsigned int cache_size = 4, unsigned int readahead = 8);
+    ~VertexCachePlayer();
+
+    unsigned int frameCount() const;
+    unsigned int valueCount() const; // floats per frame
+
+    const float *frame(unsigned int i); // decoded frame i, valid until the next call
+};
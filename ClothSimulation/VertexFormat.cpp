@@ -0,0 +1,88 @@
+#include "VertexFormat.h"
+#include <cmath>
+#include <cstring>
+
+void VertexPacker::packVertices(const float *vbuff, const float *nbuff, unsigned int n_vertices, PackedVertex *out)
+{
+#pragma omp parallel for schedule(static)
+    for (int v = 0; v < (int)n_vertices; v++)
+    {
+        out[v].position[0] = vbuff[3 * v + 0];
+        out[v].position[1] = vbuff[3 * v + 1];
+        out[v].position[2] = vbuff[3 * v + 2];
+        encodeNormal(nbuff + 3 * v, out[v].normal);
+    }
+}
+
+void VertexPacker::packTexCoords(const float *tbuff, unsigned int n_vertices, uint16_t *out)
+{
+    for (unsigned int i = 0; i < 2 * n_vertices; i++)
+        out[i] = toHalf(tbuff[i]);
+}
+
+void VertexPacker::encodeNormal(const float *n, int16_t *e)
+{
+    // project onto the octahedron
+    float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    float inv = l1 > 0.0f ? 1.0f / l1 : 0.0f;
+    float x = n[0] * inv, y = n[1] * inv;
+
+    // fold the lower half
+    if (n[2] < 0.0f)
+    {
+        float fx = std::copysign(1.0f - std::fabs(y), x);
+        float fy = std::copysign(1.0f - std::fabs(x), y);
+        x = fx;
+        y = fy;
+    }
+
+    // |x|, |y| <= 1 here, round half away from zero
+    e[0] = (int16_t)(x * 32767.0f + std::copysign(0.5f, x));
+    e[1] = (int16_t)(y * 32767.0f + std::copysign(0.5f, y));
+}
+
+void VertexPacker::decodeNormal(const int16_t *e, float *n)
+{
+    // same as packed.vshader
+    float x = std::fmax(e[0] / 32767.0f, -1.0f), y = std::fmax(e[1] / 32767.0f, -1.0f);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    float t = std::fmax(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float inv = 1.0f / std::sqrt(x * x + y * y + z * z);
+    n[0] = x * inv;
+    n[1] = y * inv;
+    n[2] = z * inv;
+}
+
+uint16_t VertexPacker::toHalf(float f)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent >= 31) // overflow, infinity and nan
+        return (uint16_t)(sign | 0x7c00 | (((bits >> 23) & 0xff) == 0xff && mantissa ? 0x200 : 0));
+    if (exponent <= 0) // subnormal or zero
+    {
+        if (exponent < -10)
+            return (uint16_t)sign;
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1)))
+            half++;
+        return (uint16_t)(sign | half);
+    }
+
+    // round to nearest even, a mantissa carry correctly bumps the exponent
+    uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        half++;
+    return (uint16_t)(sign | half);
+}
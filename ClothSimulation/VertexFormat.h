@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+
+// Packed streamed vertex, 16 bytes instead of 24 for float positions and normals
+//
+// Normals are octahedral encoded: projected onto the octahedron |x|+|y|+|z| = 1,
+// the lower half folded over the upper, and the resulting square stored as two
+// 16-bit snorm values. Texture coordinates do not change per frame and are
+// packed separately as two half floats.
+struct PackedVertex
+{
+    float position[3];
+    int16_t normal[2]; // octahedral, snorm16
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must be 16 bytes");
+
+class VertexPacker
+{
+public:
+    // interleave positions and octahedral normals, 3 floats per vertex in vbuff and nbuff
+    static void packVertices(const float *vbuff, const float *nbuff, unsigned int n_vertices, PackedVertex *out);
+
+    // 2 floats per vertex in tbuff to 2 half floats per vertex in out
+    static void packTexCoords(const float *tbuff, unsigned int n_vertices, uint16_t *out);
+
+    static void encodeNormal(const float *n, int16_t *e);
+    static void decodeNormal(const int16_t *e, float *n);
+    static uint16_t toHalf(float f);
+};
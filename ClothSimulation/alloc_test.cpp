@@ -0,0 +1,163 @@
+// Heap allocation test
+//
+// usage: fms-alloc-test [frames]
+//
+// Steps scenes covering every solver and the optional features with no
+// recorder attached and counts the heap allocations made by the time steps
+// after the first frame, on any thread, which must make none. With glibc the
+// malloc family itself is wrapped so Eigen's and the OpenMP runtime's
+// allocations are counted too, elsewhere only operator new is.
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Scene.h"
+
+static std::atomic<bool> g_counting(false);
+static std::atomic<unsigned long> g_allocations(0);
+
+static void count()
+{
+    if (g_counting.load(std::memory_order_relaxed))
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+#ifdef __GLIBC__
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t n, size_t size);
+    void *__libc_realloc(void *p, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+
+    void *malloc(size_t size) noexcept
+    {
+        count();
+        return __libc_malloc(size);
+    }
+    void *calloc(size_t n, size_t size) noexcept
+    {
+        count();
+        return __libc_calloc(n, size);
+    }
+    void *realloc(void *p, size_t size) noexcept
+    {
+        count();
+        return __libc_realloc(p, size);
+    }
+    void *memalign(size_t alignment, size_t size) noexcept
+    {
+        count();
+        return __libc_memalign(alignment, size);
+    }
+    void *aligned_alloc(size_t alignment, size_t size) noexcept
+    {
+        count();
+        return __libc_memalign(alignment, size);
+    }
+    int posix_memalign(void **p, size_t alignment, size_t size) noexcept
+    {
+        count();
+        if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+        void *q = __libc_memalign(alignment, size);
+        if (!q && size)
+            return ENOMEM;
+        *p = q;
+        return 0;
+    }
+}
+#else
+void *operator new(std::size_t size)
+{
+    count();
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+#endif
+
+// allocations made by frames 1 .. frames - 1 of the scene
+static unsigned long stepAllocations(const SceneDescription &desc, unsigned int frames)
+{
+    Scene scene(desc);
+    scene.step();
+    g_allocations.store(0);
+    g_counting.store(true);
+    for (unsigned int frame = 1; frame < frames; frame++)
+        scene.step();
+    g_counting.store(false);
+    return g_allocations.load();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int frames = argc > 1 ? std::stoul(argv[1]) : 50;
+
+    struct Case
+    {
+        const char *name;
+        SceneDescription desc;
+    };
+    std::vector<Case> cases;
+    for (LinearSolver::Type solver : {LinearSolver::Cholesky, LinearSolver::Banded,
+                                      LinearSolver::Multigrid, LinearSolver::Supernodal})
+    {
+        SceneDescription desc;
+        desc.solver = solver;
+        desc.pins = {0, desc.n - 1};
+        cases.push_back({LinearSolver::name(solver), desc});
+    }
+    {
+        SceneDescription desc;
+        desc.pins = {0, desc.n - 1};
+        desc.tauc = 0.4f;
+        cases.push_back({"deformation", desc});
+        desc.adaptive = true;
+        cases.push_back({"adaptive", desc});
+    }
+    {
+        // regions fall asleep within the counted frames
+        SceneDescription desc;
+        desc.pins = {0, desc.n - 1};
+        desc.tauc = 0.4f;
+        desc.sleep_speed = 0.5f;
+        desc.sleep_steps = 10;
+        cases.push_back({"sleep", desc});
+    }
+    {
+        SceneDescription desc;
+        desc.pins = {0, desc.n - 1};
+        desc.levels = 2;
+        desc.level = 1;
+        desc.detail_iterations = 2;
+        cases.push_back({"multires", desc});
+        desc.levels = 3;
+        desc.level = 0;
+        cases.push_back({"lod", desc});
+    }
+
+    int failures = 0;
+    try
+    {
+        for (const Case &c : cases)
+        {
+            unsigned long allocations = stepAllocations(c.desc, frames);
+            std::cout << c.name << ": " << allocations << " heap allocations" << std::endl;
+            if (allocations > 0)
+                failures++;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Exception caught: " << e.what() << std::endl;
+        return -1;
+    }
+    return failures > 0 ? -1 : 0;
+}
@@ -0,0 +1,103 @@
+// Headless batch simulation
+//
+// usage: fms-batch <scene file> [--frames n] [--cache file] [--obj file] [--checkpoint file]
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "Scene.h"
+#include "Checkpoint.h"
+#include "Sleep.h"
+#include "VertexCache.h"
+
+static void usage()
+{
+    std::cerr << "usage: fms-batch <scene file> [--frames n] [--cache file] [--obj file] [--checkpoint file]"
+              << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        usage();
+        return -1;
+    }
+
+    try
+    {
+        // arguments
+        SceneDescription desc;
+        desc.load(argv[1]);
+        const char *cache_path = nullptr;
+        const char *obj_path = nullptr;
+        const char *checkpoint_path = nullptr;
+        for (int i = 2; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            if (i + 1 >= argc)
+            {
+                usage();
+                return -1;
+            }
+            if (arg == "--frames")
+                desc.frames = std::stoul(argv[++i]);
+            else if (arg == "--cache")
+                cache_path = argv[++i];
+            else if (arg == "--obj")
+                obj_path = argv[++i];
+            else if (arg == "--checkpoint")
+                checkpoint_path = argv[++i];
+            else
+            {
+                usage();
+                return -1;
+            }
+        }
+
+        // build
+        auto start = std::chrono::steady_clock::now();
+        Scene scene(desc);
+        std::unique_ptr<VertexCacheRecorder> recorder;
+        if (cache_path)
+            recorder.reset(new VertexCacheRecorder(cache_path, scene.vbuffLen()));
+        double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // simulate
+        start = std::chrono::steady_clock::now();
+        for (unsigned int frame = 0; frame < desc.frames; frame++)
+        {
+            scene.step();
+            if (recorder)
+                recorder->push(scene.vbuff());
+        }
+        double sim_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // outputs
+        if (recorder)
+        {
+            recorder->close();
+            recorder->printStats();
+        }
+        if (obj_path)
+            scene.writeObj(obj_path);
+        if (checkpoint_path)
+            Checkpoint::save(checkpoint_path, *scene.solver, {scene.fixer});
+
+        std::cout << scene.system->n_points << " points, " << scene.system->n_springs << " springs, "
+                  << LinearSolver::name(desc.solver) << " solver, "
+                  << "build " << build_seconds * 1000 << " ms, "
+                  << desc.frames << " frames in " << sim_seconds << " s "
+                  << "(" << desc.frames / sim_seconds << " frames/s), "
+                  << scene.solver->averageIterations() << " iterations per time step" << std::endl;
+        if (RegionSleep *sleep = scene.solver->getSleep())
+            std::cout << sleep->sleepingRegions() << " of " << sleep->regionCount() << " regions asleep" << std::endl;
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Exception caught: " << e.what() << std::endl;
+        return -1;
+    }
+}
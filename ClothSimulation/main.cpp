@@ -1,13 +1,24 @@
 // #include <GL/glew.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include "Shader.h"
 #include "Renderer.h"
 #include "Mesh.h"
+#include "MeshImport.h"
 #include "MassSpringSolver.h"
 #include "UserInteraction.h"
+#include "Checkpoint.h"
+#include "VertexCache.h"
+#include "LockFree.h"
+#include "Timestep.h"
+#include "VertexFormat.h"
 
 // GLOBALS
 
@@ -21,18 +32,17 @@ static float g_mouseClickX;
 static float g_mouseClickY;
 
 bool firstMouse = true;
-bool launced = false;
+std::atomic<bool> launced(false);
 
 // User Interaction
 static UserInteraction *UI;
-static Renderer *g_pickRenderer;
+static float g_grab_radius = 0.15f; // graph distance, set with --grab-radius r
 
 // Constants
 static const float PI = glm::pi<float>();
 
 // Shader Handles
 static PhongShader *g_phongShader; // linked phong shader
-static PickShader *g_pickShader;   // linked pick shader
 
 // Shader parameters
 static const glm::vec3 g_albedo(0.0f, 0.3f, 0.7f);
@@ -40,17 +50,23 @@ static const glm::vec3 g_ambient(0.01f, 0.01f, 0.01f);
 static const glm::vec3 g_light(1.0f, 1.0f, -1.0f);
 
 // Mesh
-static Mesh *g_clothMesh; // halfedge data structure
+static Mesh *g_clothMesh; // flat buffers and normal adjacency
 
 // Render Target
 static Renderer renderer;
 static ProgramInput *g_render_target; // vertex, normal, texture, index
 
 // Animation
-static const int g_fps = 60;        // frames per second  | 60
-static const int g_iter = 5;        // iterations per time step | 10
-static const int g_frame_time = 15; // approximate time for frame calculations | 15
-static const int g_animation_timer = (int)((1.0f / g_fps) * 1000 - g_frame_time);
+static const int g_iter = 5;          // iterations per time step | 10
+static const bool g_adaptive = false; // adaptive iteration count instead of g_iter | false
+static const int g_min_iter = 1;      // adaptive iteration bounds | 1, 10
+static const int g_max_iter = 10;
+static const float g_iter_tol = 0.05f;     // relative convergence tolerance | 0.05f
+static const float g_iter_abs_tol = 1e-5f; // absolute convergence tolerance (RMS) | 1e-5f
+static const int g_substeps = 2;      // time steps per published frame | 2
+static const int g_max_substeps = 8;  // time steps per frame before simulated time is dropped | 8
+static const float g_sleep_speed = 0.0f;   // RMS speed below which regions fall asleep, 0 disables | 0.01f
+static const int g_sleep_steps = 60;       // time steps below g_sleep_speed before a region sleeps | 60
 
 // Mass Spring System
 static mass_spring_system *g_system;
@@ -71,6 +87,49 @@ namespace SystemParam
 
 // Constraint Graph
 static CgRootNode *g_cgRootNode;
+static Checkpoint::FixerList g_fixers; // point fix nodes saved in checkpoints
+static CgRegionFixNode *g_grabber;     // mouse grab, never saved in checkpoints
+
+// Simulation thread
+struct ClothFrame
+{
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<PackedVertex> packed; // replaces positions and normals with --packed
+};
+struct SimCommand
+{
+    enum Type
+    {
+        Grab,      // grab point i
+        Move,      // move grabbed point by v
+        Release,   // release grabbed point
+        Save,      // save checkpoint
+        Restore    // restore checkpoint
+    } type;
+    int i;
+    float v[3];
+};
+static std::thread g_simThread;
+static std::atomic<bool> g_simRunning(false);
+static TripleBuffer<ClothFrame> g_frames;        // sim -> render, latest positions and normals
+static SpscQueue<SimCommand, 256> g_commands;    // render -> sim, user actions
+
+// Checkpoint
+static const char *g_checkpoint_path = "./checkpoint.fms";
+
+// Vertex cache recording, enabled with --record <file>
+static VertexCacheRecorder *g_recorder = nullptr;
+
+// Vertex cache playback, enabled with --play <file>
+static VertexCachePlayer *g_player = nullptr;
+static unsigned int g_play_frame = 0; // current playback frame
+static bool g_play_paused = false;
+static const char *g_mesh_path = nullptr; // playback mesh, set with --mesh <file>
+
+// Packed vertex format, enabled with --packed
+static bool g_packed = false;
+static std::vector<PackedVertex> g_packedVertices; // render thread packing buffer
 
 // Scene parameters
 static const float g_camera_distance = 4.2f;
@@ -97,11 +156,17 @@ static void (*g_demo)() = demo_drop;
 
 // draw cloth function
 static void drawCloth();
-static void animateCloth();
+static void animateCloth(unsigned int steps);
+static void simulate();   // simulation thread
+static void sendCommand(SimCommand::Type type, int i = -1, glm::vec3 v = glm::vec3(0));
+static void runCommands(); // apply queued user actions on the simulation thread
+static void publishFrame();
+static void playCloth(); // replay recorded frames instead of simulating
 
 // scene update
 static void updateProjection();
 static void updateRenderTarget();
+static void uploadMesh(); // upload g_clothMesh positions and normals from the render thread
 
 // glfw callbacks
 static void framebuffer_size_callback(GLFWwindow *window, int width, int height);
@@ -111,18 +176,43 @@ static void processInput(GLFWwindow *window);
 // error checks
 void checkGlErrors();
 
-int main()
+int main(int argc, char **argv)
 {
     try
     {
+        const char *record_path = nullptr;
+        for (int i = 1; i < argc; i++)
+        {
+            if (std::string(argv[i]) == "--record" && i + 1 < argc)
+                record_path = argv[++i];
+            else if (std::string(argv[i]) == "--play" && i + 1 < argc)
+                g_player = new VertexCachePlayer(argv[++i]);
+            else if (std::string(argv[i]) == "--mesh" && i + 1 < argc)
+                g_mesh_path = argv[++i];
+            else if (std::string(argv[i]) == "--packed")
+                g_packed = true;
+            else if (std::string(argv[i]) == "--grab-radius" && i + 1 < argc)
+                g_grab_radius = std::stof(argv[++i]);
+        }
+        if (g_mesh_path && !g_player)
+            throw std::runtime_error("--mesh needs --play, only grids are simulated.");
+
         initGlfwState();
         initGLState();
         initShaders();
         initCloth();
         initScene();
         initRenderer();
+        if (record_path)
+            g_recorder = new VertexCacheRecorder(record_path, g_clothMesh->vbuffLen());
         display();
 
+        if (g_recorder)
+        {
+            g_recorder->close();
+            g_recorder->printStats();
+            delete g_recorder;
+        }
         return 0;
     }
     catch (const std::runtime_error &e)
@@ -160,6 +250,7 @@ static void initGlfwState()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return;
     }
+    StreamBuffer::loadExtensions((GLADloadproc)glfwGetProcAddress);
 
     return;
 }
@@ -182,19 +273,14 @@ static void initShaders()
 {
     GLShader basic_vert(GL_VERTEX_SHADER);
     GLShader phong_frag(GL_FRAGMENT_SHADER);
-    GLShader pick_frag(GL_FRAGMENT_SHADER);
-    auto ibasic = std::ifstream("./shaders/basic.vshader");
+    auto ibasic = std::ifstream(g_packed ? "./shaders/packed.vshader" : "./shaders/basic.vshader");
     auto iphong = std::ifstream("./shaders/phong.fshader");
-    auto ifrag = std::ifstream("./shaders/pick.fshader");
 
     basic_vert.compile(ibasic);
     phong_frag.compile(iphong);
-    pick_frag.compile(ifrag);
 
     g_phongShader = new PhongShader;
-    g_pickShader = new PickShader;
     g_phongShader->link(basic_vert, phong_frag);
-    g_pickShader->link(basic_vert, pick_frag);
 
     checkGlErrors();
 }
@@ -206,19 +292,38 @@ static void initCloth()
     const float w = SystemParam::w;
 
     // generate mesh
-    MeshBuilder meshBuilder;
-    meshBuilder.uniformGrid(w, n);
-    g_clothMesh = meshBuilder.getResult();
+    if (g_mesh_path)
+        g_clothMesh = MeshImporter::read(g_mesh_path);
+    else
+    {
+        MeshBuilder meshBuilder;
+        meshBuilder.uniformGrid(w, n);
+        g_clothMesh = meshBuilder.getResult();
+    }
 
     // fill program input
     g_render_target = new ProgramInput;
-    g_render_target->setPositionData(g_clothMesh->vbuff(), g_clothMesh->vbuffLen());
-    g_render_target->setNormalData(g_clothMesh->nbuff(), g_clothMesh->nbuffLen());
-    g_render_target->setTextureDate(g_clothMesh->tbuff(), g_clothMesh->tbuffLen());
+    if (g_packed)
+    {
+        std::vector<uint16_t> texcoords(2 * g_clothMesh->n_vertices());
+        VertexPacker::packTexCoords(g_clothMesh->tbuff(), g_clothMesh->n_vertices(), texcoords.data());
+        g_render_target->setPackedTextureData(texcoords.data(), g_clothMesh->n_vertices());
+        g_packedVertices.resize(g_clothMesh->n_vertices());
+    }
+    else
+        g_render_target->setTextureDate(g_clothMesh->tbuff(), g_clothMesh->tbuffLen());
     g_render_target->setIndexData(g_clothMesh->ibuff(), g_clothMesh->ibuffLen());
+    uploadMesh();
 
     checkGlErrors();
 
+    // playback does not need a mass spring system
+    if (g_player)
+    {
+        if (g_player->valueCount() != g_clothMesh->vbuffLen())
+            throw std::runtime_error("Vertex cache does not match the cloth mesh.");
+        return;
+    }
     g_demo();
 }
 
@@ -263,6 +368,8 @@ static void demo_hang()
 
     // initialize mass spring solver
     g_solver = new MassSpringSolver(g_system, g_clothMesh->vbuff());
+    if (g_sleep_speed > 0.0f)
+        g_solver->enableSleeping(g_sleep_speed, g_sleep_steps);
 
     // deformation constraint parameters
     const float tauc = 0.4f;            // critical spring deformation | 0.4f
@@ -281,13 +388,9 @@ static void demo_hang()
     cornerFixer->fixPoint(n - 1);
 
     // initialize user interaction
-    g_pickRenderer = new Renderer();
-    g_pickRenderer->setProgram(g_pickShader);
-    g_pickRenderer->setProgramInput(g_render_target);
-    g_pickRenderer->setElementCount(g_clothMesh->ibuffLen());
-    g_pickShader->setTessFact(SystemParam::n);
-    CgPointFixNode *mouseFixer = new CgPointFixNode(g_system, g_clothMesh->vbuff());
-    UI = new GridMeshUI(g_pickRenderer, mouseFixer, g_clothMesh->vbuff(), n);
+    CgRegionFixNode *mouseFixer = new CgRegionFixNode(g_system, g_clothMesh->vbuff());
+    UI = new UserInteraction(mouseFixer, g_clothMesh->vbuff(), g_clothMesh->ibuff(), g_clothMesh->ibuffLen());
+    UI->setRadius(g_grab_radius);
 
     // build constraint graph
     g_cgRootNode = new CgRootNode(g_system, g_clothMesh->vbuff());
@@ -298,6 +401,10 @@ static void demo_hang()
     // second layer
     deformationNode->addChild(cornerFixer);
     deformationNode->addChild(mouseFixer);
+
+    // checkpointed pin sets
+    g_fixers = {cornerFixer};
+    g_grabber = mouseFixer;
 }
 
 static void demo_drop()
@@ -319,6 +426,8 @@ static void demo_drop()
 
     // initialize mass spring solver
     g_solver = new MassSpringSolver(g_system, g_clothMesh->vbuff());
+    if (g_sleep_speed > 0.0f)
+        g_solver->enableSleeping(g_sleep_speed, g_sleep_steps);
 
     // sphere collision constraint parameters
     const float radius = 0.64f;             // sphere radius | 0.64f
@@ -340,13 +449,9 @@ static void demo_drop()
     deformationNode->addSprings(massSpringBuilder.getStructIndex());
 
     // initialize user interaction
-    g_pickRenderer = new Renderer();
-    g_pickRenderer->setProgram(g_pickShader);
-    g_pickRenderer->setProgramInput(g_render_target);
-    g_pickRenderer->setElementCount(g_clothMesh->ibuffLen());
-    g_pickShader->setTessFact(SystemParam::n);
-    CgPointFixNode *mouseFixer = new CgPointFixNode(g_system, g_clothMesh->vbuff());
-    UI = new GridMeshUI(g_pickRenderer, mouseFixer, g_clothMesh->vbuff(), n);
+    CgRegionFixNode *mouseFixer = new CgRegionFixNode(g_system, g_clothMesh->vbuff());
+    UI = new UserInteraction(mouseFixer, g_clothMesh->vbuff(), g_clothMesh->ibuff(), g_clothMesh->ibuffLen());
+    UI->setRadius(g_grab_radius);
 
     // build constraint graph
     g_cgRootNode = new CgRootNode(g_system, g_clothMesh->vbuff());
@@ -357,11 +462,31 @@ static void demo_drop()
 
     // second layer
     deformationNode->addChild(mouseFixer);
+
+    // checkpointed pin sets
+    g_fixers = {};
+    g_grabber = mouseFixer;
 }
 
 // GLFW Callbacks
 static void display()
 {
+    // simulation runs on its own thread, playback stays on this one
+    if (!g_player)
+    {
+        ClothFrame frame;
+        if (g_packed)
+            frame.packed = g_packedVertices;
+        else
+        {
+            frame.positions.assign(g_clothMesh->vbuff(), g_clothMesh->vbuff() + g_clothMesh->vbuffLen());
+            frame.normals.assign(g_clothMesh->nbuff(), g_clothMesh->nbuff() + g_clothMesh->nbuffLen());
+        }
+        g_frames.reset(frame);
+        g_simRunning = true;
+        g_simThread = std::thread(simulate);
+    }
+
     // render loop
     while (!glfwWindowShouldClose(window))
     {
@@ -373,7 +498,10 @@ static void display()
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // also clear the depth buffer now!
 
         // cloth simulation
-        animateCloth();
+        if (g_player)
+            playCloth();
+        else if (g_frames.update())
+            updateRenderTarget();
         drawCloth();
 
         // glfw: swap buffers and poll IO events (keys pressed / released, mouse moved etc.)
@@ -381,6 +509,13 @@ static void display()
         glfwPollEvents();
     }
 
+    // stop simulation
+    if (g_simThread.joinable())
+    {
+        g_simRunning = false;
+        g_simThread.join();
+    }
+
     // glfw: terminate, clearing all previously allocated GLFW resources
     glfwTerminate();
     return;
@@ -388,6 +523,9 @@ static void display()
 // button click && mouse move event callback
 static void mouse_callback(GLFWwindow *window, double xposIn, double yposIn)
 {
+    if (!UI)
+        return;
+
     g_mouseLClickButton = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
     g_mouseRClickButton = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
     g_mouseMClickButton = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_MIDDLE) == GLFW_PRESS;
@@ -403,9 +541,18 @@ static void mouse_callback(GLFWwindow *window, double xposIn, double yposIn)
         g_mouseClickX = xpos;
         g_mouseClickY = ypos;
         firstMouse = false;
+        int width, height;
+        glfwGetWindowSize(window, &width, &height);
         UI->setModelview(g_ModelViewMatrix);
         UI->setProjection(g_ProjectionMatrix);
-        UI->grabPoint(g_mouseClickX, g_mouseClickY);
+        UI->setViewport(width, height);
+
+        // pick on the displayed frame, the simulation thread owns the mesh
+        const ClothFrame &frame = g_frames.readBuffer();
+        if (g_packed)
+            sendCommand(SimCommand::Grab, UI->pickPoint(xpos, ypos, frame.packed[0].position, sizeof(PackedVertex) / sizeof(float)));
+        else
+            sendCommand(SimCommand::Grab, UI->pickPoint(xpos, ypos, frame.positions.data()));
     }
     else if (!firstMouse && g_mouseClickDown)
     {
@@ -414,20 +561,23 @@ static void mouse_callback(GLFWwindow *window, double xposIn, double yposIn)
         const float yoffset = g_mouseClickY - ypos; // reversed since y-coordinates go from bottom to top
         glm::vec3 ux(0, 1, 0);
         glm::vec3 uy(0, 0, -1);
-        UI->movePoint(0.01f * (xoffset * ux + yoffset * uy));
+        sendCommand(SimCommand::Move, -1, 0.01f * (xoffset * ux + yoffset * uy));
         g_mouseClickX = xpos;
         g_mouseClickY = ypos;
     }
     else if (!g_mouseClickDown)
     {
         // mouse release
-        UI->releasePoint();
+        if (!firstMouse)
+            sendCommand(SimCommand::Release);
         firstMouse = true;
     }
 }
 
 static void processInput(GLFWwindow *window)
 {
+    static bool saveDown = false, restoreDown = false, pauseDown = false;
+
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
     {
         glfwSetWindowShouldClose(window, true);
@@ -436,6 +586,35 @@ static void processInput(GLFWwindow *window)
     {
         launced = true;
     }
+
+    // playback controls
+    if (g_player)
+    {
+        bool pause = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
+        if (pause && !pauseDown)
+            g_play_paused = !g_play_paused;
+        pauseDown = pause;
+
+        // scrub one frame per rendered frame while an arrow key is held
+        unsigned int n_frames = g_player->frameCount();
+        if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
+            g_play_frame = (g_play_frame + 1) % n_frames;
+        if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
+            g_play_frame = (g_play_frame + n_frames - 1) % n_frames;
+        if (glfwGetKey(window, GLFW_KEY_HOME) == GLFW_PRESS)
+            g_play_frame = 0;
+        return;
+    }
+
+    // checkpoint on key press only, not every frame the key is held
+    bool save = glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS;
+    bool restore = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+    if (save && !saveDown)
+        sendCommand(SimCommand::Save);
+    if (restore && !restoreDown)
+        sendCommand(SimCommand::Restore);
+    saveDown = save;
+    restoreDown = restore;
 }
 
 static void framebuffer_size_callback(GLFWwindow *window, int width, int height)
@@ -452,25 +631,132 @@ static void drawCloth()
     renderer.draw();
 }
 
-static void animateCloth()
+static void simulate()
 {
-    if (!launced)
-        return;
-    // solve two time-steps
-    g_solver->solve(g_iter);
-    g_solver->solve(g_iter);
+    typedef std::chrono::steady_clock clock;
+
+    // wake once per frame of g_substeps time steps, the accumulator decides how many to run
+    FixedTimestep timestep(SystemParam::h, g_max_substeps);
+    const auto period = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<float>(g_substeps * SystemParam::h));
+    auto last = clock::now();
+    while (g_simRunning)
+    {
+        runCommands();
+
+        auto now = clock::now();
+        unsigned int steps = timestep.advance(std::chrono::duration<float>(now - last).count());
+        last = now;
+        if (!launced)
+            timestep.reset();
+        else if (steps > 0)
+        {
+            animateCloth(steps);
+            publishFrame();
+        }
+
+        std::this_thread::sleep_until(now + period);
+    }
+    if (timestep.droppedSteps() > 0)
+        std::cout << "Simulation fell behind, dropped " << timestep.droppedSteps() << " time steps." << std::endl;
+}
+
+static void sendCommand(SimCommand::Type type, int i, glm::vec3 v)
+{
+    SimCommand command = {type, i, {v[0], v[1], v[2]}};
+    if (!g_commands.push(command))
+        std::cout << "Simulation command queue full, dropped command." << std::endl;
+}
 
-    // fix points
+static void runCommands()
+{
+    SimCommand command;
+    while (g_commands.pop(command))
+    {
+        switch (command.type)
+        {
+        case SimCommand::Grab:
+            UI->grabPoint(command.i);
+            break;
+        case SimCommand::Move:
+            UI->movePoint(glm::vec3(command.v[0], command.v[1], command.v[2]));
+            break;
+        case SimCommand::Release:
+            UI->releasePoint();
+            break;
+        case SimCommand::Save:
+        case SimCommand::Restore:
+            try
+            {
+                if (command.type == SimCommand::Save)
+                {
+                    Checkpoint::save(g_checkpoint_path, *g_solver, g_fixers, g_grabber);
+                    std::cout << "Saved checkpoint " << g_checkpoint_path << std::endl;
+                }
+                else
+                {
+                    Checkpoint::restore(g_checkpoint_path, *g_solver, g_fixers, g_grabber);
+                    publishFrame();
+                    std::cout << "Restored checkpoint " << g_checkpoint_path << std::endl;
+                }
+            }
+            catch (const std::runtime_error &e)
+            {
+                std::cout << "Checkpoint failed: " << e.what() << std::endl;
+            }
+            break;
+        }
+    }
+}
+
+static void publishFrame()
+{
+    ClothFrame &frame = g_frames.writeBuffer();
+    if (g_packed)
+        VertexPacker::packVertices(g_clothMesh->vbuff(), g_clothMesh->nbuff(), g_clothMesh->n_vertices(), frame.packed.data());
+    else
+    {
+        std::memcpy(frame.positions.data(), g_clothMesh->vbuff(), sizeof(float) * g_clothMesh->vbuffLen());
+        std::memcpy(frame.normals.data(), g_clothMesh->nbuff(), sizeof(float) * g_clothMesh->nbuffLen());
+    }
+    g_frames.publish();
+}
+
+static void animateCloth(unsigned int steps)
+{
+    // solve time steps, constraints and collisions after each
     CgSatisfyVisitor visitor;
-    visitor.satisfy(*g_cgRootNode);
+    for (unsigned int i = 0; i < steps; i++)
+    {
+        if (g_adaptive)
+            g_solver->solveAdaptive(g_min_iter, g_max_iter, g_iter_tol, g_iter_abs_tol);
+        else
+            g_solver->solve(g_iter);
+        visitor.satisfy(*g_cgRootNode);
+    }
 
     // update normals
-    g_clothMesh->request_face_normals();
-    g_clothMesh->update_normals();
-    g_clothMesh->release_face_normals();
+    g_clothMesh->updateNormals();
+
+    // record frame
+    if (g_recorder)
+        g_recorder->push(g_clothMesh->vbuff());
+}
+
+static void playCloth()
+{
+    // decoded frame becomes the mesh positions
+    const float *frame = g_player->frame(g_play_frame);
+    std::memcpy(g_clothMesh->vbuff(), frame, sizeof(float) * g_clothMesh->vbuffLen());
+
+    // update normals
+    g_clothMesh->updateNormals();
 
     // update target
-    updateRenderTarget();
+    uploadMesh();
+
+    if (!g_play_paused)
+        g_play_frame = (g_play_frame + 1) % g_player->frameCount();
 }
 
 // SCENE UPDATE
@@ -482,11 +768,33 @@ static void updateProjection()
 
 static void updateRenderTarget()
 {
+    // latest frame published by the simulation thread
+    const ClothFrame &frame = g_frames.readBuffer();
+    if (g_packed)
+    {
+        g_render_target->setPackedVertexData((PackedVertex *)frame.packed.data(), (unsigned int)frame.packed.size());
+        return;
+    }
+
     // update vertex positions
-    g_render_target->setPositionData(g_clothMesh->vbuff(), g_clothMesh->vbuffLen());
+    g_render_target->setPositionData((float *)frame.positions.data(), (unsigned int)frame.positions.size());
 
     // update vertex normals
-    g_render_target->setNormalData(g_clothMesh->nbuff(), g_clothMesh->vbuffLen());
+    g_render_target->setNormalData((float *)frame.normals.data(), (unsigned int)frame.normals.size());
+}
+
+static void uploadMesh()
+{
+    if (g_packed)
+    {
+        VertexPacker::packVertices(g_clothMesh->vbuff(), g_clothMesh->nbuff(), g_clothMesh->n_vertices(), g_packedVertices.data());
+        g_render_target->setPackedVertexData(g_packedVertices.data(), g_clothMesh->n_vertices());
+    }
+    else
+    {
+        g_render_target->setPositionData(g_clothMesh->vbuff(), g_clothMesh->vbuffLen());
+        g_render_target->setNormalData(g_clothMesh->nbuff(), g_clothMesh->nbuffLen());
+    }
 }
 
 // ERRORS
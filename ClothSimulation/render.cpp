@@ -0,0 +1,223 @@
+// Headless rendering to an image sequence
+//
+// Simulates a scene and renders every frame into an offscreen framebuffer of
+// an EGL context, frames are read back asynchronously and written as numbered
+// PNG or PPM images by a writer thread. LIBGL_ALWAYS_SOFTWARE=1 selects Mesa's
+// software rasterizer on machines without a gpu.
+//
+// usage: fms-render <scene file> --out pattern [--frames n] [--size WxH] [--packed] [--dolly d0 d1]
+//   pattern is a printf pattern ending in .png or .ppm, e.g. frames/cloth%04d.png
+//   --dolly moves the camera from distance d0 to d1 over the frames, scenes
+//   with lod levels switch level by the camera, see LodSelector
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Lod.h"
+#include "Offscreen.h"
+#include "Renderer.h"
+#include "Scene.h"
+
+static const float PI = 3.14159265358979f;
+
+// shading and camera of the viewer
+static const glm::vec3 g_albedo(0.0f, 0.3f, 0.7f);
+static const glm::vec3 g_ambient(0.01f, 0.01f, 0.01f);
+static const glm::vec3 g_light(1.0f, 1.0f, -1.0f);
+static const float g_camera_distance = 4.2f;
+
+static void usage()
+{
+    std::cerr << "usage: fms-render <scene file> --out pattern [--frames n] [--size WxH] [--packed] [--dolly d0 d1]"
+              << std::endl;
+}
+
+static glm::mat4 modelview(float distance, float width)
+{
+    return glm::lookAt(
+               glm::vec3(0.618, -0.786, 0.3f) * distance,
+               glm::vec3(0.0f, 0.0f, -1.0f),
+               glm::vec3(0.0f, 0.0f, 1.0f)) *
+           glm::translate(glm::mat4(1), glm::vec3(0.0f, 0.0f, width / 4));
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        usage();
+        return -1;
+    }
+
+    try
+    {
+        // arguments
+        SceneDescription desc;
+        desc.load(argv[1]);
+        const char *pattern = nullptr;
+        unsigned int width = 640, height = 640;
+        bool packed = false;
+        float dolly[2] = {g_camera_distance, g_camera_distance};
+        for (int i = 2; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            if (arg == "--packed")
+            {
+                packed = true;
+                continue;
+            }
+            if (i + 1 >= argc)
+            {
+                usage();
+                return -1;
+            }
+            if (arg == "--out")
+                pattern = argv[++i];
+            else if (arg == "--frames")
+                desc.frames = std::stoul(argv[++i]);
+            else if (arg == "--dolly" && i + 2 < argc)
+            {
+                dolly[0] = std::stof(argv[++i]);
+                dolly[1] = std::stof(argv[++i]);
+            }
+            else if (arg == "--size")
+            {
+                if (std::sscanf(argv[++i], "%ux%u", &width, &height) != 2 || width == 0 || height == 0)
+                {
+                    usage();
+                    return -1;
+                }
+            }
+            else
+            {
+                usage();
+                return -1;
+            }
+        }
+        if (!pattern)
+        {
+            usage();
+            return -1;
+        }
+
+        // context
+        EglContext context;
+        if (!gladLoadGLLoader((GLADloadproc)EglContext::getProcAddress))
+            throw std::runtime_error("Failed to initialize GLAD");
+        StreamBuffer::loadExtensions((GLADloadproc)EglContext::getProcAddress);
+        std::cout << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+
+        Framebuffer framebuffer(width, height);
+        framebuffer.bind();
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
+        glEnable(GL_FRAMEBUFFER_SRGB);
+        glClearColor(0.25f, 0.25f, 0.25f, 0);
+
+        // shaders
+        GLShader basic_vert(GL_VERTEX_SHADER);
+        GLShader phong_frag(GL_FRAGMENT_SHADER);
+        auto ibasic = std::ifstream(packed ? "./shaders/packed.vshader" : "./shaders/basic.vshader");
+        auto iphong = std::ifstream("./shaders/phong.fshader");
+        basic_vert.compile(ibasic);
+        phong_frag.compile(iphong);
+        PhongShader shader;
+        shader.link(basic_vert, phong_frag);
+
+        // scene
+        Scene scene(desc);
+        Mesh &mesh = *scene.mesh;
+        std::vector<PackedVertex> packed_vertices(packed ? mesh.n_vertices() : 0);
+        ProgramInput input;
+        if (packed)
+        {
+            std::vector<uint16_t> texcoords(2 * mesh.n_vertices());
+            VertexPacker::packTexCoords(mesh.tbuff(), mesh.n_vertices(), texcoords.data());
+            input.setPackedTextureData(texcoords.data(), mesh.n_vertices());
+        }
+        else
+            input.setTextureDate(mesh.tbuff(), mesh.tbuffLen());
+        input.setIndexData(mesh.ibuff(), mesh.ibuffLen());
+
+        Renderer renderer;
+        renderer.setProgram(&shader);
+        renderer.setProjection(glm::perspective(PI / 4.0f, width * 1.0f / height, 0.01f, 1000.0f));
+        shader.setAlbedo(g_albedo);
+        shader.setAmbient(g_ambient);
+        shader.setLight(g_light);
+        renderer.setProgramInput(&input);
+        renderer.setElementCount(mesh.ibuffLen());
+        renderer.setFramebuffer(framebuffer);
+
+        // simulate, render and read back, images are written by the writer thread
+        ImageWriter writer(pattern, width, height);
+        PixelReader reader(&writer, width, height);
+        LodSelector lod(PI / 4.0f, height);
+        std::vector<unsigned int> level_frames(scene.levelCount(), 0);
+        double sim_seconds = 0.0, render_seconds = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int frame = 0; frame < desc.frames; frame++)
+        {
+            const float t = desc.frames > 1 ? (float)frame / (desc.frames - 1) : 0.0f;
+            const glm::mat4 view = modelview(dolly[0] + t * (dolly[1] - dolly[0]), desc.width);
+            renderer.setModelview(view);
+
+            auto sim_start = std::chrono::steady_clock::now();
+            if (scene.levelCount() > 1)
+                scene.setLevel(lod.select(glm::value_ptr(view), scene));
+            level_frames[scene.level()]++;
+            scene.step();
+            mesh.updateNormals();
+            if (packed)
+                VertexPacker::packVertices(mesh.vbuff(), mesh.nbuff(), mesh.n_vertices(), packed_vertices.data());
+            sim_seconds += secondsSince(sim_start);
+
+            auto render_start = std::chrono::steady_clock::now();
+            if (packed)
+                input.setPackedVertexData(packed_vertices.data(), mesh.n_vertices());
+            else
+            {
+                input.setPositionData(mesh.vbuff(), mesh.vbuffLen());
+                input.setNormalData(mesh.nbuff(), mesh.nbuffLen());
+            }
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderer.draw();
+            reader.read();
+            render_seconds += secondsSince(render_start);
+        }
+        reader.flush();
+        double loop_seconds = secondsSince(start);
+        writer.close();
+        double total_seconds = secondsSince(start);
+
+        writer.printStats();
+        std::cout << desc.frames << " frames at " << width << "x" << height << " in " << total_seconds << " s "
+                  << "(" << desc.frames / total_seconds << " frames/s, " << desc.frames / loop_seconds
+                  << " frames/s before the writer drained), "
+                  << "simulation " << sim_seconds / desc.frames * 1000 << " ms/frame, "
+                  << "render and readback " << render_seconds / desc.frames * 1000 << " ms/frame, "
+                  << reader.stallCount() << " readback stalls" << std::endl;
+        if (scene.levelCount() > 1)
+        {
+            std::cout << "frames per level:";
+            for (unsigned int k = 0; k < scene.levelCount(); k++)
+                std::cout << " " << level_frames[k];
+            std::cout << std::endl;
+        }
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Exception caught: " << e.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,206 @@
+// Vertex upload benchmark
+//
+// Replays simulated cloth frames through ProgramInput with each stream mode
+// and reports the CPU time spent uploading positions and normals, as floats or
+// with --packed as PackedVertex. Runs in a hidden window, LIBGL_ALWAYS_SOFTWARE=1
+// selects Mesa's software rasterizer.
+//
+// usage: fms-upload-bench [--grid n] [--frames n] [--packed]
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+#include "Renderer.h"
+#include "Scene.h"
+
+static void usage()
+{
+    std::cerr << "usage: fms-upload-bench [--grid n] [--frames n] [--packed]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    SceneDescription desc;
+    desc.pins = {0};
+    unsigned int n_frames = 300;
+    bool packed = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--packed")
+        {
+            packed = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            usage();
+            return -1;
+        }
+        if (arg == "--grid")
+            desc.n = std::stoul(argv[++i]);
+        else if (arg == "--frames")
+            n_frames = std::stoul(argv[++i]);
+        else
+        {
+            usage();
+            return -1;
+        }
+    }
+
+    // hidden window
+    if (!glfwInit())
+        return -1;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(640, 640, "fms-upload-bench", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+    StreamBuffer::loadExtensions((GLADloadproc)glfwGetProcAddress);
+    std::cout << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+
+    try
+    {
+        // simulated frames, the cloth swings from one corner
+        Scene scene(desc);
+        const unsigned int n_recorded = std::min(n_frames, 60u);
+        std::vector<std::vector<float>> positions(n_recorded), normals(n_recorded);
+        for (unsigned int f = 0; f < n_recorded; f++)
+        {
+            scene.step();
+            scene.mesh->updateNormals();
+            positions[f].assign(scene.mesh->vbuff(), scene.mesh->vbuff() + scene.mesh->vbuffLen());
+            normals[f].assign(scene.mesh->nbuff(), scene.mesh->nbuff() + scene.mesh->nbuffLen());
+        }
+        const unsigned int n_vertices = scene.mesh->n_vertices();
+
+        // packed frames, packing runs on the simulation thread in the viewer
+        std::vector<std::vector<PackedVertex>> packed_frames(packed ? n_recorded : 0);
+        std::vector<uint16_t> texcoords(2 * n_vertices);
+        if (packed)
+        {
+            for (std::vector<PackedVertex> &frame : packed_frames)
+                frame.resize(n_vertices);
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned int f = 0; f < n_recorded; f++)
+                VertexPacker::packVertices(positions[f].data(), normals[f].data(), n_vertices, packed_frames[f].data());
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            VertexPacker::packTexCoords(scene.mesh->tbuff(), n_vertices, texcoords.data());
+
+            // normal quantization error
+            double max_error = 0.0;
+            for (unsigned int v = 0; v < n_vertices; v++)
+            {
+                const float *n = normals[0].data() + 3 * v;
+                float d[3];
+                VertexPacker::decodeNormal(packed_frames[0][v].normal, d);
+                double c = std::min(1.0, (double)(n[0] * d[0] + n[1] * d[1] + n[2] * d[2]));
+                max_error = std::max(max_error, std::acos(c));
+            }
+            std::cout << "packing " << seconds / n_recorded * 1000 << " ms/frame, max normal error "
+                      << max_error * 180.0 / 3.14159265358979 << " degrees" << std::endl;
+        }
+
+        // shaders
+        GLShader basic_vert(GL_VERTEX_SHADER);
+        GLShader phong_frag(GL_FRAGMENT_SHADER);
+        auto ibasic = std::ifstream(packed ? "./shaders/packed.vshader" : "./shaders/basic.vshader");
+        auto iphong = std::ifstream("./shaders/phong.fshader");
+        basic_vert.compile(ibasic);
+        phong_frag.compile(iphong);
+        PhongShader shader;
+        shader.link(basic_vert, phong_frag);
+
+        const size_t frame_bytes = packed ? sizeof(PackedVertex) * n_vertices : 2 * sizeof(float) * scene.mesh->vbuffLen();
+        std::cout << n_vertices << " vertices, "
+                  << frame_bytes / 1024 << " KiB per frame, "
+                  << n_frames << " frames" << std::endl;
+
+        const StreamBuffer::Mode modes[] = {StreamBuffer::Static, StreamBuffer::Orphan, StreamBuffer::Persistent};
+        for (StreamBuffer::Mode mode : modes)
+        {
+            if (mode == StreamBuffer::Persistent && !StreamBuffer::persistentSupported())
+            {
+                std::cout << StreamBuffer::name(mode) << ": GL_ARB_buffer_storage not supported" << std::endl;
+                continue;
+            }
+
+            ProgramInput input(mode);
+            if (packed)
+                input.setPackedTextureData(texcoords.data(), n_vertices);
+            else
+                input.setTextureDate(scene.mesh->tbuff(), scene.mesh->tbuffLen());
+            input.setIndexData(scene.mesh->ibuff(), scene.mesh->ibuffLen());
+            Renderer renderer;
+            renderer.setProgram(&shader);
+            renderer.setModelview(glm::mat4(1));
+            renderer.setProjection(glm::mat4(1));
+            renderer.setProgramInput(&input);
+            renderer.setElementCount(scene.mesh->ibuffLen());
+
+            double upload_seconds = 0.0, max_upload_seconds = 0.0;
+            glFinish();
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned int f = 0; f < n_frames; f++)
+            {
+                std::vector<float> &p = positions[f % n_recorded];
+                std::vector<float> &nrm = normals[f % n_recorded];
+
+                auto upload_start = std::chrono::steady_clock::now();
+                if (packed)
+                    input.setPackedVertexData(packed_frames[f % n_recorded].data(), n_vertices);
+                else
+                {
+                    input.setPositionData(p.data(), (unsigned int)p.size());
+                    input.setNormalData(nrm.data(), (unsigned int)nrm.size());
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - upload_start).count();
+                upload_seconds += seconds;
+                max_upload_seconds = std::max(max_upload_seconds, seconds);
+
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderer.draw();
+                glfwSwapBuffers(window);
+            }
+            glFinish();
+            double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << StreamBuffer::name(mode) << ": upload "
+                      << upload_seconds / n_frames * 1000 << " ms/frame (max "
+                      << max_upload_seconds * 1000 << " ms), frame "
+                      << total_seconds / n_frames * 1000 << " ms, "
+                      << input.streamStalls() << " fence waits" << std::endl;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Exception caught: " << e.what() << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+
+    glfwTerminate();
+    return 0;
+}